@@ -14,9 +14,254 @@
 // 
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <string>
 #include "array_stack.h"
+#include "inplace_or_heap_stack.h"
+#include "concurrent_array_stack.h"
+#include "work_stealing_deque.h"
+#include "soa_array_stack.h"
+#include "heap_array_stack.h"
+#include "array_stack_pool.h"
+#include "ring_array_stack.h"
+#include "array_stack_stats.h"
+#include "array_stack_parallel.h"
+#include "array_stack_snapshot.h"
+#include "mapped_array_stack.h"
+#include "twin_array_stack.h"
+#include "segmented_array_stack.h"
+#include "monoid_array_stack.h"
+#include "async_array_stack.h"
+#include "handle_array_stack.h"
 
 // Implementation file is useful for validating that the header will compile
 // but is otherwise unnecessary
 
+namespace // anonymous
+{
+
+// Reverse iteration must visit only live elements, starting at the top of the stack
+constexpr bool ReverseIterationStartsAtTop()
+{
+  PKIsensee::array_stack<int, 8> s;
+  for( int i = 1; i <= 3; ++i )
+    s.push( i );
+  int expected = 3;
+  for( auto v : s.top_down() )
+    if( v != expected-- )
+      return false;
+  return *s.crbegin() == s.top() && std::distance( s.rbegin(), s.rend() ) == 3 && expected == 0;
+}
+static_assert( ReverseIterationStartsAtTop() );
+
+// Objects that aren't trivial are copied and pushed from ranges during constant evaluation too
+constexpr bool NonTrivialElementsAreConstexpr()
+{
+  PKIsensee::array_stack<std::string, 4> s;
+  s.push( "a" );
+  const std::string more[] = { "b", "c" };
+  s.push_range( more );
+  PKIsensee::array_stack<std::string, 4> copy( s );
+  copy = s;
+  return copy.size() == 3 && copy.top() == "c";
+}
+static_assert( NonTrivialElementsAreConstexpr() );
+
+// Pushes are noexcept when the overflow policy and constructing the element both are
+template <typename T, typename Overflow>
+struct OverflowTraits : PKIsensee::array_stack_traits<T, 4>
+{
+  using overflow_policy = Overflow;
+};
+template <typename T, typename Overflow = PKIsensee::overflow::drop_new>
+using OverflowStack = PKIsensee::array_stack<T, 4, OverflowTraits<T, Overflow>>;
+static_assert( noexcept( OverflowStack<int>{}.push( 1 ) ) );
+static_assert( noexcept( OverflowStack<std::string>{}.push( std::string() ) ) );
+static_assert( !noexcept( OverflowStack<std::string>{}.push( std::declval<const std::string&>() ) ) );
+static_assert( !noexcept( OverflowStack<std::string>{}.push_range( std::declval<const std::string(&)[2]>() ) ) );
+static_assert( noexcept( OverflowStack<std::string>{}.push_range( std::declval<std::string(&&)[2]>() ) ) );
+static_assert( noexcept( OverflowStack<int, PKIsensee::overflow::assert_>{}.emplace( 1 ) ) );
+static_assert( !noexcept( OverflowStack<std::string, PKIsensee::overflow::assert_>{}.emplace( "a" ) ) );
+static_assert( !noexcept( OverflowStack<int, PKIsensee::overflow::throw_>{}.push( 1 ) ) );
+
+// A moved-from heap stack allocates a buffer again when it grows, whatever fills it
+using HeapIntStack = PKIsensee::array_stack<int, 16, PKIsensee::heap_array_stack_traits<int, 16>>;
+static_assert( !noexcept( HeapIntStack{}.push( 1 ) ) );
+static_assert( !noexcept( std::declval<HeapIntStack&>() = std::declval<const HeapIntStack&>() ) );
+static_assert( !noexcept( std::declval<HeapIntStack&>() = std::declval<HeapIntStack>() ) );
+static_assert( !noexcept( std::declval<HeapIntStack&>().swap( std::declval<HeapIntStack&>() ) ) );
+static_assert( !noexcept( std::declval<HeapIntStack&>().from_bytes( {} ) ) );
+using IntStack4 = PKIsensee::array_stack<int, 4>;
+static_assert( noexcept( std::declval<IntStack4&>() = std::declval<const IntStack4&>() ) );
+static_assert( noexcept( std::declval<IntStack4&>() = std::declval<IntStack4>() ) );
+static_assert( noexcept( std::declval<IntStack4&>().swap( std::declval<IntStack4&>() ) ) );
+static_assert( noexcept( std::declval<IntStack4&>().from_bytes( {} ) ) );
+
+// Frames nest, and rewinding an inner frame leaves the outer one valid
+constexpr bool NestedFramesRewind()
+{
+  PKIsensee::array_stack<std::string, 8> s;
+  s.push( "a" );
+  const auto outer = s.mark();
+  s.push( "b" );
+  const auto inner = s.mark();
+  s.push( "c" );
+  s.rewind( inner );
+  s.push( "d" );
+  s.rewind( outer );
+  return s.size() == 1 && s.top() == "a";
+}
+static_assert( NestedFramesRewind() );
+
+// A full ring replaces its oldest element, even with a copy of that element
+constexpr bool RingStackOverwritesOldest()
+{
+  PKIsensee::ring_array_stack<std::string, 2> r;
+  r.push( "a" );
+  r.push( "b" );
+  r.push( r.bottom() );
+  r.emplace( 3, 'c' );
+  return r.size() == 2 && r.bottom() == "a" && r.top() == "ccc";
+}
+static_assert( RingStackOverwritesOldest() );
+
+// Aggregates follow pushes and pops
+constexpr bool MonoidStackAggregates()
+{
+  PKIsensee::monoid_array_stack<std::string, 4, PKIsensee::monoid::min<std::string>> s;
+  s.push( "b" );
+  s.push( "a" );
+  s.push( "c" );
+  const bool pushed = s.aggregate() == "a";
+  s.pop();
+  s.pop();
+  return pushed && s.aggregate() == "b";
+}
+static_assert( MonoidStackAggregates() );
+
+// Two stacks share one array, and only overflow together
+constexpr bool TwinStacksShareCapacity()
+{
+  PKIsensee::twin_array_stack<std::string, 4> s;
+  s.push<0>( "a" );
+  s.push<1>( "b" );
+  s.push<1>( s.top<0>() );
+  s.push<0>( "c" );
+  s.pop<1>();
+  PKIsensee::twin_array_stack<std::string, 4> copy( s );
+  return !copy.full() && copy.size<0>() == 2 && copy.size<1>() == 1 &&
+         copy.top<0>() == "c" && copy.top<1>() == "b";
+}
+static_assert( TwinStacksShareCapacity() );
+
+// Segments are repacked as stacks outgrow them, keeping every element in order
+constexpr bool SegmentedStacksRepack()
+{
+  PKIsensee::segmented_array_stack<std::string, 6, 3> s;
+  for( auto v : { "a", "b", "c", "d" } )
+    s.push<1>( v );
+  s.push<0>( "e" );
+  s.push<2>( "f" );
+  s.pop<1>();
+  return !s.full() && s.size() == 5 && s.size<1>() == 3 && s.top<1>() == "c" &&
+         s.top<0>() == "e" && s.top<2>() == "f";
+}
+static_assert( SegmentedStacksRepack() );
+
+// A handle stops finding its element once the element is popped, even if the slot is reused
+constexpr bool HandlesDetectPoppedElements()
+{
+  PKIsensee::handle_array_stack<std::string, 4> s;
+  s.push( "outer" );
+  const auto h = s.handle( 0 );
+  const bool found = s.get( h ) != nullptr && *s.get( h ) == "outer";
+  s.pop();
+  s.push( "inner" );
+  return found && s.get( h ) == nullptr && s.get( s.handle( 0 ) ) != nullptr;
+}
+static_assert( HandlesDetectPoppedElements() );
+
+// Spilling to the heap keeps every element, and shrinking brings them back inline
+constexpr bool InplaceOrHeapStackSpills()
+{
+  PKIsensee::inplace_or_heap_stack<std::string, 2> s;
+  s.push_range( std::array<std::string, 3>{ "a", "b", "c" } );
+  PKIsensee::inplace_or_heap_stack<std::string, 2> copy( s );
+  copy.pop();
+  copy.shrink_to_fit();
+  return s.size() == 3 && s.top() == "c" && copy.capacity() == 2 && copy.top() == "b";
+}
+static_assert( InplaceOrHeapStackSpills() );
+static_assert( noexcept( std::declval<PKIsensee::inplace_or_heap_stack<std::string, 2>&>().swap(
+  std::declval<PKIsensee::inplace_or_heap_stack<std::string, 2>&>() ) ) );
+
+// Columns share one count, and pushing to a full stack follows the overflow policy
+constexpr bool SoaStackDropsOnOverflow()
+{
+  PKIsensee::basic_soa_array_stack<PKIsensee::overflow::drop_new, 2, int, float> s;
+  s.push( 1, 1.0f );
+  s.push( 2, 2.0f );
+  s.push( 3, 3.0f );
+  return s.size() == 2 && s.top<0>() == 2 && s.column<1>().back() == 2.0f && s.contains<0>( 1 );
+}
+static_assert( SoaStackDropsOnOverflow() );
+static_assert( noexcept( PKIsensee::basic_soa_array_stack<PKIsensee::overflow::drop_new, 2, int>{}.push( 1 ) ) );
+
+// Aligned stacks keep the count and the elements on their own cache lines
+using AlignedStack = PKIsensee::aligned_array_stack<char, 10>;
+static_assert( alignof( AlignedStack ) == CacheLine && sizeof( AlignedStack ) == 2 * CacheLine );
+#if !defined(PK_ARRAY_STACK_DEBUG)
+static_assert( sizeof( PKIsensee::array_stack<char, 10> ) == 11 );
+#endif
+
+// Compile-time built stacks are sized exactly
+constexpr auto Primes = PKIsensee::make_array_stack( 2, 3, 5, 7 );
+static_assert( Primes.capacity() == 4 && Primes.full() && Primes.top() == 7 );
+constexpr auto Evens = PKIsensee::make_array_stack_from<[]
+{
+  PKIsensee::array_stack<int, 100> s;
+  for( int i = 0; i < 10; i += 2 )
+    s.push( i );
+  return s;
+}>();
+static_assert( Evens.capacity() == 5 && Evens.full() && Evens.top() == 8 );
+
+// Snapshots are a fixed header followed by the live elements
+static_assert( PKIsensee::snapshot_size( Primes ) == sizeof( PKIsensee::array_stack_snapshot_header ) + 4 * sizeof( int ) );
+static_assert( PKIsensee::make_snapshot_header<double, 8>( 3 ).element_size == sizeof( double ) );
+
+} // namespace anonymous
+
+// Containers that aren't usable at compile time have every member instantiated instead
+template class PKIsensee::concurrent_array_stack<std::string, 64>;
+template class PKIsensee::work_stealing_deque<void*, 64>;
+template class PKIsensee::async_array_stack<std::string, 64>;
+template class PKIsensee::async_array_stack<std::string, 64, std::mutex>; // concurrent_async_array_stack
+template class PKIsensee::array_stack_pool<std::string, 64, 8>;
+template class PKIsensee::array_stack_pool<std::string, 64, 8>::local_cache<>;
+template class PKIsensee::mapped_array_stack<int, 1024>;
+template class PKIsensee::array_stack<int, 256, // registered_array_stack, with a tag that's never defined
+  PKIsensee::registered_array_stack_traits<int, 256, struct ParserTag>>;
+template class PKIsensee::array_stack<std::string, 1024, // heap_array_stack
+  PKIsensee::heap_array_stack_traits<std::string, 1024>>;
+template class PKIsensee::array_stack<std::string, 1024, // pmr::heap_array_stack
+  PKIsensee::heap_array_stack_traits<std::string, 1024, std::pmr::polymorphic_allocator<std::string>>>;
+
+// Parallel algorithms are instantiated over a stack, with plain function objects
+using IntStack = PKIsensee::array_stack<int, 1024>;
+template void PKIsensee::parallel::for_each<IntStack&, void(*)( int& )>(
+  IntStack&, void(*)( int& ), const PKIsensee::parallel::options& );
+template long PKIsensee::parallel::transform_reduce<const IntStack&, long, std::plus<>, std::identity>(
+  const IntStack&, long, std::plus<>, std::identity, const PKIsensee::parallel::options& );
+template IntStack::iterator PKIsensee::parallel::find_if<IntStack&, bool(*)( int )>(
+  IntStack&, bool(*)( int ), const PKIsensee::parallel::options& );
+template void PKIsensee::parallel::sort<IntStack&, std::ranges::less>(
+  IntStack&, std::ranges::less, const PKIsensee::parallel::options& );
+template IntStack::iterator PKIsensee::parallel::partition<IntStack&, bool(*)( int )>(
+  IntStack&, bool(*)( int ), const PKIsensee::parallel::options& );
+
+// Snapshots, which copy bytes and so aren't usable at compile time either
+template size_t PKIsensee::write_snapshot( const IntStack&, std::span<std::byte> );
+template bool PKIsensee::read_snapshot( IntStack&, std::span<const std::byte> );
+template std::span<const int> PKIsensee::snapshot_elements<int, 1024>( std::span<const std::byte> );
+
 ///////////////////////////////////////////////////////////////////////////////
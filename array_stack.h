@@ -2,7 +2,7 @@
 //
 //  array_stack.h
 //
-//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  Copyright � Pete Isensee (PKIsensee@msn.com).
 //  All rights reserved worldwide.
 //
 //  Permission to copy, modify, reproduce or redistribute this source code is
@@ -28,21 +28,83 @@
 #pragma once
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
 #include <compare>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <version>
+#include "array_stack_simd.h"
 
 // Uncomment the following line to enable exceptions, or define this symbol at build time
 // #define PK_ENABLE_EXCEPTIONS 1
 
 #if defined(PK_ENABLE_EXCEPTIONS)
-  #include <stdexcept>
   #define PK_MAY_THROW noexcept(false) // indicates function may throw
 #else
   #define PK_MAY_THROW noexcept(true) // function will not throw
 #endif
 
+// Uncomment the following line to fill popped slots with a pattern and, in AddressSanitizer
+// builds, mark them unaddressable, or define this symbol at build time
+// #define PK_ARRAY_STACK_DEBUG 1
+
+// Uncomment the following line to keep bounds checks in release builds, where they
+// abort instead of asserting, or define this symbol at build time
+// #define PK_ARRAY_STACK_HARDENED 1
+
+// Uncomment the following line to cap the inline storage of every stack, so that one too
+// large for a thread stack fails to compile, or define this symbol at build time. 65536
+// leaves room to spare in a 512KB thread stack. See also array_stack_traits::max_bytes.
+// #define PK_ARRAY_STACK_MAX_BYTES 65536
+
+#if defined(PK_ARRAY_STACK_HARDENED)
+  #define PK_ASSERT( cond ) ( ( cond ) ? void( 0 ) : std::abort() ) // checked even with NDEBUG
+#else
+  #define PK_ASSERT( cond ) assert( cond )
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+  #define PK_ASAN 1
+#elif defined(__has_feature)
+  #if __has_feature(address_sanitizer)
+    #define PK_ASAN 1
+  #endif
+#endif
+
+#if defined(PK_ARRAY_STACK_DEBUG) && defined(PK_ASAN)
+extern "C" void __sanitizer_annotate_contiguous_container( const void* beg, const void* end,
+                                                           const void* old_mid, const void* new_mid );
+#endif
+
+// Empty members take no space; MSVC ignores the standard attribute
+#if defined(_MSC_VER)
+  #define PK_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+  #define PK_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+// Cache line size used to keep objects off each other's cache lines. It's a fixed value
+// rather than std::hardware_destructive_interference_size, which can vary with compiler
+// flags and would then change class layouts. Define this symbol at build time to override.
+#if !defined(PK_CACHE_LINE_SIZE)
+  #if defined(__APPLE__) && defined(__aarch64__)
+    #define PK_CACHE_LINE_SIZE 128
+  #else
+    #define PK_CACHE_LINE_SIZE 64
+  #endif
+#endif
+
 namespace // anonymous
 {
 
@@ -56,39 +118,440 @@ concept BooleanTestable = BooleanTestableImpl<T>
   { !static_cast<T&&>( a ) } -> BooleanTestableImpl;
 };
 
-// Helper converts input iterators into an array
-// Usage: std::array<int, Capacity> arr = MakeArray<InIt, Capacity>( vec.begin(), vec.end() );
-template<typename InIt, size_t Capacity>
-constexpr auto MakeArray( InIt first, InIt last )
-{
-  const auto count = std::distance( first, last );
-  assert( count <= Capacity );
-  using ValType = typename std::iterator_traits<InIt>::value_type;
-  std::array<ValType, Capacity> arr;
-  std::copy_n( first, count, std::begin( arr ) );
-  return arr;
+// Synthesize a comparison operation even for objects that don't support <=> operator.
+// Used by operator<=> of array_stack and related containers
+struct SynthThreeWay
+{
+  template <typename U, typename V>
+  constexpr auto operator()( const U& lhs, const V& rhs ) const noexcept
+    requires requires
+    {
+      { lhs < rhs } -> BooleanTestable;
+      { lhs > rhs } -> BooleanTestable;
+    }
+  {
+    if constexpr( std::three_way_comparable_with<U, V> )
+      return lhs <=> rhs; // U supports operator <=>
+    else
+    { // implement <=> equivalent using existing < and > operators
+      if( lhs < rhs )
+        return std::strong_ordering::less;
+      if( lhs > rhs )
+        return std::strong_ordering::greater;
+      return std::strong_ordering::equal;
+    }
+  }
+};
+
+// Objects that cost nothing to create or destroy can be stored in a plain std::array,
+// which keeps array_stack fully constexpr. All other objects are stored in uninitialized
+// storage so that only live elements are ever constructed.
+template <typename T>
+concept TrivialStorage = std::is_trivially_default_constructible_v<T> &&
+                         std::is_trivially_destructible_v<T>;
+
+// Raw storage for objects that are not trivial; only live elements are ever constructed
+template <typename T, size_t N>
+union UninitializedArray
+{
+  constexpr UninitializedArray() noexcept {}
+  constexpr ~UninitializedArray() {}
+  T elements_[N];
+};
+
+// Inline storage for N objects T: a std::array for trivial objects, raw storage otherwise
+template <typename T, size_t N>
+using InlineStorage = std::conditional_t<TrivialStorage<T>, std::array<T, N>, UninitializedArray<T, N>>;
+
+template <typename T, size_t N>
+constexpr T* StorageData( std::array<T, N>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N>
+constexpr const T* StorageData( const std::array<T, N>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N>
+constexpr T* StorageData( UninitializedArray<T, N>& storage ) noexcept
+{
+  return storage.elements_;
+}
+
+template <typename T, size_t N>
+constexpr const T* StorageData( const UninitializedArray<T, N>& storage ) noexcept
+{
+  return storage.elements_;
+}
+
+// Tells storage that its first size slots are live; called before elements are constructed
+// and after they're destroyed. Only CheckedStorage does anything with it.
+template <typename Storage>
+constexpr void StorageResize( Storage&, size_t ) noexcept
+{
 }
 
-// Helper converts range into an array
-// Usage: std::array<int, Capacity> arr = MakeArray<Range, Capacity>( rng );
-template<typename Range, size_t Capacity>
-constexpr auto MakeArray( Range&& rng )
-  requires std::ranges::sized_range<decltype( rng )>
-{
-  const auto count = static_cast<int64_t>( std::ranges::size( rng ) );
-  assert( count <= Capacity );
-  using ValType = std::iter_value_t<decltype( rng )>;
-  std::array<ValType, Capacity> arr;
-  std::ranges::copy_n( std::begin( rng ), count, std::begin( arr ) );
-  return arr;
+// How many times slot i has been vacated, for storage that counts it; a marker checks that
+// the slot below it wasn't vacated between mark() and rewind(). Only CheckedStorage counts.
+template <typename Storage>
+constexpr uint32_t StorageVacated( const Storage&, size_t ) noexcept
+{
+  return 0;
 }
 
+// Storage that keeps its elements in a buffer of its own, like heap_array_stack's, provides
+// StorageSwap(), which exchanges two buffers if their allocators allow it, and StorageTake(),
+// which does the same for move assignment; both return whether they did. The stack copies
+// such storage along with its elements, assigns it when empty, and gives it to a move.
+template <typename Storage>
+concept BufferStorage = requires( Storage& s ) {
+  { StorageSwap( s, s ) } -> std::same_as<bool>;
+  { StorageTake( s, s ) } -> std::same_as<bool>;
+};
+
+// InlineStorage for PK_ARRAY_STACK_DEBUG builds. Dead slots are filled with DeadSlotByte
+// and, under AddressSanitizer, annotated as the unused part of a contiguous container, so
+// reading a popped element or past end() is reported as a container-overflow. Each slot
+// also counts how many times it has been vacated, to catch stale markers.
+template <typename T, size_t N>
+class CheckedStorage
+{
+public:
+
+  static constexpr unsigned char DeadSlotByte = 0xDD;
+
+  constexpr CheckedStorage() noexcept
+  {
+    resize( 0 );
+  }
+
+  // The owning array_stack copies the elements; storage only provides the slots
+  constexpr CheckedStorage( const CheckedStorage& ) noexcept :
+    CheckedStorage()
+  {
+  }
+
+  constexpr CheckedStorage& operator=( const CheckedStorage& ) noexcept
+  {
+    return *this;
+  }
+
+  constexpr ~CheckedStorage()
+  {
+    // The memory will be reused by its next owner
+    if( !std::is_constant_evaluated() )
+      Annotate( size_, N );
+  }
+
+  constexpr T* data() noexcept
+  {
+    return StorageData( storage_ );
+  }
+
+  constexpr const T* data() const noexcept
+  {
+    return StorageData( storage_ );
+  }
+
+  constexpr void resize( size_t size ) noexcept
+  {
+    if( !std::is_constant_evaluated() )
+    {
+      if( size < size_ )
+        std::memset( static_cast<void*>( data() + size ), DeadSlotByte, ( size_ - size ) * sizeof( T ) );
+      Annotate( size_, size );
+    }
+    for( auto i = size; i < size_; ++i )
+      ++vacated_[i];
+    size_ = size;
+  }
+
+  constexpr uint32_t vacated( size_t i ) const noexcept
+  {
+    return vacated_[i];
+  }
+
+private:
+
+  void Annotate( [[maybe_unused]] size_t oldSize, [[maybe_unused]] size_t newSize ) const noexcept
+  {
+#if defined(PK_ASAN)
+    // Older ASan runtimes require an 8-byte aligned container, and a partial granule at
+    // the end may be shared with the next object, so only the aligned interior is annotated
+    const auto first = reinterpret_cast<uintptr_t>( data() );
+    const auto beg = ( first + 7 ) & ~uintptr_t( 7 );
+    const auto end = ( first + N * sizeof( T ) ) & ~uintptr_t( 7 );
+    if( beg >= end || oldSize == newSize )
+      return;
+    const auto mid = [=]( size_t size ) {
+      return reinterpret_cast<const void*>( std::clamp( first + size * sizeof( T ), beg, end ) );
+    };
+    __sanitizer_annotate_contiguous_container( reinterpret_cast<const void*>( beg ),
+                                               reinterpret_cast<const void*>( end ),
+                                               mid( oldSize ), mid( newSize ) );
+#endif
+  }
+
+private:
+
+  InlineStorage<T, N> storage_;
+  size_t size_ = N; // every slot starts out addressable
+  std::array<uint32_t, N> vacated_ {};
+
+};
+
+template <typename T, size_t N>
+constexpr T* StorageData( CheckedStorage<T, N>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N>
+constexpr const T* StorageData( const CheckedStorage<T, N>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N>
+constexpr void StorageResize( CheckedStorage<T, N>& storage, size_t size ) noexcept
+{
+  storage.resize( size );
+}
+
+template <typename T, size_t N>
+constexpr uint32_t StorageVacated( const CheckedStorage<T, N>& storage, size_t i ) noexcept
+{
+  return storage.vacated( i );
+}
+
+// Contiguous iterators over trivially copyable T; such a source can be copied with memcpy
+template <typename It, typename T>
+concept BitwiseCopyableFrom = std::contiguous_iterator<It> && std::is_trivially_copyable_v<T> &&
+                              std::is_same_v<std::iter_value_t<It>, T>;
+
+template <typename It>
+constexpr bool IsMoveIterator = false;
+
+template <typename It>
+constexpr bool IsMoveIterator<std::move_iterator<It>> = true;
+
+// Iterator to the first element of rng, from which objects T are constructed. Elements of
+// an rvalue container are moved. Elements seen through lvalues and views belong to someone
+// else, so they're copied.
+template <typename T, typename Range>
+constexpr auto ForwardFrom( Range&& rng )
+{
+  if constexpr( std::is_lvalue_reference_v<Range> || std::ranges::view<std::remove_cvref_t<Range>> ||
+                std::ranges::borrowed_range<Range> || std::is_trivially_copyable_v<T> )
+    return std::ranges::begin( rng );
+  else
+    return std::make_move_iterator( std::ranges::begin( rng ) );
+}
+
+// Objects whose equality is exactly equality of their bytes, so can be compared with memcmp
+template <typename T>
+concept BitwiseComparable = ( std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> ) &&
+                            std::has_unique_object_representations_v<T>;
+
+// Exchange the first byteCount bytes of two non-overlapping buffers in small chunks
+inline void SwapBytes( void* lhs, void* rhs, size_t byteCount ) noexcept
+{
+  auto l = static_cast<std::byte*>( lhs );
+  auto r = static_cast<std::byte*>( rhs );
+  std::byte buffer[ 256 ];
+  while( byteCount > 0 )
+  {
+    const auto chunk = std::min( byteCount, sizeof( buffer ) );
+    std::memcpy( buffer, l, chunk );
+    std::memcpy( l, r, chunk );
+    std::memcpy( r, buffer, chunk );
+    l += chunk;
+    r += chunk;
+    byteCount -= chunk;
+  }
+}
+
+// Compare two equal-length runs of contiguous elements for equality
+template <typename T>
+constexpr bool EqualElements( const T* lhs, const T* rhs, size_t count ) noexcept
+{
+  if constexpr( BitwiseComparable<T> )
+  {
+    if( !std::is_constant_evaluated() )
+      return count == 0 || std::memcmp( lhs, rhs, count * sizeof( T ) ) == 0;
+  }
+  else if constexpr( SimdElement<T> ) // floating-point
+    return Mismatch( lhs, rhs, count ) == count;
+  return std::equal( lhs, lhs + count, rhs );
+}
+
+// Lexicographically compare two runs of contiguous elements, even for objects that
+// don't support operator<=>
+template <typename T>
+constexpr auto CompareElements( const T* lhs, size_t lhsCount,
+                                const T* rhs, size_t rhsCount ) noexcept
+{
+  if constexpr( SimdElement<T> )
+  {
+    // Only the first differing element needs an ordered comparison
+    using Ordering = decltype( SynthThreeWay{}( *lhs, *rhs ) );
+    const auto common = std::min( lhsCount, rhsCount );
+    const auto i = Mismatch( lhs, rhs, common );
+    if( i < common )
+      return Ordering( SynthThreeWay{}( lhs[i], rhs[i] ) );
+    return Ordering( lhsCount <=> rhsCount );
+  }
+  else
+    return std::lexicographical_compare_three_way( lhs, lhs + lhsCount,
+                                                   rhs, rhs + rhsCount, SynthThreeWay{} );
+}
+
+constexpr size_t CacheLine = PK_CACHE_LINE_SIZE;
+
+#if defined(PK_ARRAY_STACK_MAX_BYTES)
+constexpr size_t MaxStackBytes = PK_ARRAY_STACK_MAX_BYTES;
+#else
+constexpr size_t MaxStackBytes = std::numeric_limits<size_t>::max();
+#endif
+
+// Smallest unsigned integer type able to hold the value N
+template <size_t N>
+using SmallestUnsigned =
+  std::conditional_t<( N <= UINT8_MAX ),  uint8_t,
+  std::conditional_t<( N <= UINT16_MAX ), uint16_t,
+  std::conditional_t<( N <= UINT32_MAX ), uint32_t, uint64_t>>>;
+
 }; // namespace anonymous
 
 namespace PKIsensee
 {
 
-template <typename T, size_t Capacity> // stack of objects T; maximum size Capacity
+// What array_stack does when pushing to a full stack; see array_stack_traits
+namespace overflow
+{
+
+struct assert_ {};  // assert; the default, unless PK_ENABLE_EXCEPTIONS is defined
+struct throw_ {};   // throw std::out_of_range; the default if PK_ENABLE_EXCEPTIONS is defined
+struct drop_new {}; // discard the elements that don't fit; see also ring_array_stack.h
+
+// Policy of array_stack_traits, and of the containers that don't take one
+#if defined(PK_ENABLE_EXCEPTIONS)
+using default_ = throw_;
+#else
+using default_ = assert_;
+#endif
+
+} // namespace overflow
+
+} // namespace PKIsensee
+
+namespace // anonymous
+{
+
+// Bounds checks shared by array_stack and the containers built like it
+
+template <typename Overflow>
+constexpr bool NothrowOverflow = !std::is_same_v<Overflow, PKIsensee::overflow::throw_>;
+
+// Removing more elements than a stack holds throws std::out_of_range if
+// PK_ENABLE_EXCEPTIONS is defined, and asserts otherwise
+constexpr void CheckElementsToRemove( [[maybe_unused]] size_t elementsToRemove,
+                                      [[maybe_unused]] size_t size )
+{
+#if defined(PK_ENABLE_EXCEPTIONS)
+  if( elementsToRemove > size )
+    throw std::out_of_range( "empty stack" );
+#else
+  PK_ASSERT( elementsToRemove <= size );
+#endif
+}
+
+// Applies Overflow, one of the overflow policies, to adding elementsToAdd to a stack of
+// size elements; returns how many of them to add, which is all of them unless the policy
+// is overflow::drop_new
+template <typename Overflow>
+constexpr size_t CheckElementsToAdd( size_t elementsToAdd, size_t size, size_t capacity )
+  noexcept( NothrowOverflow<Overflow> )
+{
+  if constexpr( std::is_same_v<Overflow, PKIsensee::overflow::drop_new> )
+    return std::min( elementsToAdd, capacity - size );
+  else if constexpr( std::is_same_v<Overflow, PKIsensee::overflow::throw_> )
+  {
+    if( ( size + elementsToAdd ) > capacity )
+      throw std::out_of_range( "stack overflow" );
+  }
+  else
+    PK_ASSERT( ( size + elementsToAdd ) <= capacity );
+  return elementsToAdd;
+}
+
+} // namespace anonymous
+
+namespace PKIsensee
+{
+
+// Statistics policy that records nothing and takes no space; the default. Any other
+// policy provides the same members; see array_stack_stats.h.
+struct no_stats
+{
+  // count elements were pushed, leaving size of capacity elements
+  constexpr void on_push( size_t /*count*/, size_t /*size*/, size_t /*capacity*/ ) noexcept {}
+
+  // count elements were popped
+  constexpr void on_pop( size_t /*count*/ ) noexcept {}
+
+  // A push found the stack too full, whatever the overflow policy then did
+  constexpr void on_overflow() noexcept {}
+};
+
+// Compile-time options for array_stack. To customize, derive from array_stack_traits,
+// hide the members of interest, and pass the result as the Traits parameter:
+//
+//   struct MyTraits : array_stack_traits<int, 100> { using index_type = size_t; };
+//   array_stack<int, 100, MyTraits> s;
+template <typename T, size_t Capacity>
+struct array_stack_traits
+{
+  // Unsigned type used to store the element count; the default is the smallest
+  // type that can represent Capacity, so small stacks stay small
+  using index_type = SmallestUnsigned<Capacity>;
+
+  // Alignment of the element count and of the element storage; the stack is padded
+  // to a multiple of it
+  static constexpr size_t alignment = alignof( T );
+
+  // Element storage, inline by default; see heap_array_stack.h for a heap buffer
+#if defined(PK_ARRAY_STACK_DEBUG)
+  using storage_type = CheckedStorage<T, Capacity>;
+#else
+  using storage_type = InlineStorage<T, Capacity>;
+#endif
+
+  // One of the overflow policies
+  using overflow_policy = overflow::default_;
+
+  // Statistics policy; see array_stack_stats.h
+  using stats_type = no_stats;
+
+  // Largest element storage allowed, checked at compile time. The default is
+  // PK_ARRAY_STACK_MAX_BYTES if defined, and otherwise unlimited.
+  static constexpr size_t max_bytes = MaxStackBytes;
+};
+
+// Places the element count and the elements on separate cache lines and pads the stack
+// to whole cache lines, so stacks stored side by side (e.g. one per thread) never share a
+// line, and the elements begin on a cache line boundary
+template <typename T, size_t Capacity>
+struct aligned_array_stack_traits : array_stack_traits<T, Capacity>
+{
+  static constexpr size_t alignment = std::max( alignof( T ), CacheLine );
+};
+
+template <typename T, size_t Capacity, // stack of objects T; maximum size Capacity
+          typename Traits = array_stack_traits<T, Capacity>>
 class array_stack
 {
 public:
@@ -98,42 +561,176 @@ public:
   using value_type              = typename Array::value_type;
   using reference               = typename Array::reference;
   using const_reference         = typename Array::const_reference;
-  using iterator                = typename Array::iterator;
-  using const_iterator          = typename Array::const_iterator;
-  using reverse_iterator        = typename Array::reverse_iterator;
-  using const_reverse_iterator  = typename Array::const_reverse_iterator;
+  using pointer                 = typename Array::pointer;
+  using const_pointer           = typename Array::const_pointer;
+  using iterator                = pointer;
+  using const_iterator          = const_pointer;
+  using reverse_iterator        = std::reverse_iterator<iterator>;
+  using const_reverse_iterator  = std::reverse_iterator<const_iterator>;
   using size_type               = typename Array::size_type;
+  using traits_type             = Traits;
+  using index_type              = typename Traits::index_type;
+  using stats_type              = typename Traits::stats_type;
+
+  static_assert( std::is_unsigned_v<index_type>, "index_type must be unsigned" );
+  static_assert( Capacity <= std::numeric_limits<index_type>::max(),
+                 "index_type is too small to hold Capacity" );
+  static_assert( std::has_single_bit( Traits::alignment ), "alignment must be a power of two" );
+  static_assert( std::is_same_v<typename Traits::overflow_policy, overflow::assert_> ||
+                 std::is_same_v<typename Traits::overflow_policy, overflow::throw_> ||
+                 std::is_same_v<typename Traits::overflow_policy, overflow::drop_new>,
+                 "overflow_policy must be one of the overflow policies" );
+  static_assert( sizeof( typename Traits::storage_type ) <= Traits::max_bytes,
+                 "array_stack exceeds max_bytes; reduce Capacity or use heap_array_stack" );
+
+private:
+
+  using Storage = typename Traits::storage_type;
+  using Overflow = typename Traits::overflow_policy;
+  using Stats = typename Traits::stats_type;
+
+  static constexpr bool DropOnOverflow = std::is_same_v<Overflow, overflow::drop_new>;
+  static constexpr bool OverflowNoexcept = NothrowOverflow<Overflow>;
+
+  // Growing the stack tells the storage first, which may allocate if it has a buffer of its
+  // own, e.g. one that was moved from
+  static constexpr bool NothrowResize = noexcept( StorageResize( std::declval<Storage&>(), size_t() ) );
+
+  // Adding an element constructs T from Args, after resizing
+  template <typename... Args>
+  static constexpr bool NothrowConstruct = std::is_nothrow_constructible_v<T, Args...> && NothrowResize;
+
+  // A checked push of elements from It or from Range
+  template <typename It>
+  static constexpr bool NothrowPushFrom = OverflowNoexcept && std::is_nothrow_default_constructible_v<Storage> &&
+                                          NothrowConstruct<std::iter_reference_t<It>>;
+
+  template <typename Range>
+  static constexpr bool NothrowPushRange = OverflowNoexcept &&
+    NothrowConstruct<std::iter_reference_t<decltype( ForwardFrom<T>( std::declval<Range>() ) )>>;
+
+public:
 
   array_stack() = default;
 
-  constexpr explicit array_stack( const Array& c ) :
-    top_( c.size() ),
-    c_( c )
+  constexpr explicit array_stack( const Array& c )
+    noexcept( std::is_nothrow_copy_constructible_v<T> && std::is_nothrow_default_constructible_v<Storage> )
+  {
+    ConstructAtTop( c.data(), Capacity );
+  }
+
+  constexpr explicit array_stack( Array&& c )
+    noexcept( std::is_nothrow_move_constructible_v<T> && std::is_nothrow_default_constructible_v<Storage> )
+  {
+    ConstructAtTop( MoveFrom( c.data() ), Capacity );
+  }
+
+  // Storage that allocates its buffer, such as heap_array_stack's, allocates from alloc
+  template <typename Alloc>
+    requires std::convertible_to<const Alloc&, typename Traits::storage_type::allocator_type>
+  constexpr explicit array_stack( const Alloc& alloc ) :
+    c_( alloc )
   {
   }
 
   template <typename InIt>
-  constexpr array_stack( InIt first, InIt last ) noexcept( std::is_nothrow_constructible_v<Array, InIt, InIt> ) :
-    top_( static_cast<size_t>( std::distance( first, last ) ) ),
-    c_{ MakeArray<InIt, Capacity>( first, last ) }
+  constexpr array_stack( InIt first, InIt last ) noexcept( NothrowPushFrom<InIt> )
   {
+    const auto count = static_cast<size_type>( std::distance( first, last ) );
+    ConstructAtTop( first, CheckForFullStack( count ) );
+    stats_.on_push( top_, top_, Capacity );
   }
 
+  // std::from_range_t is missing from older standard libraries (libstdc++ before GCC 14)
+#if defined(__cpp_lib_containers_ranges)
   template <typename Range>
-  constexpr array_stack( std::from_range_t, Range&& rng ) :
-    top_( std::size( rng ) ),
-    c_( MakeArray<Range, Capacity>( rng ) )
+  constexpr array_stack( std::from_range_t, Range&& rng )
+    noexcept( NothrowPushRange<Range> && std::is_nothrow_default_constructible_v<Storage> )
+  {
+    push_range( std::forward<Range>( rng ) );
+  }
+#endif
+
+  // Only the live elements [0, top_) are copied, moved or destroyed, never the entire
+  // array. Trivially copyable elements are copied with a single memcpy.
+
+  ~array_stack() requires TrivialStorage<T> = default;
+
+  constexpr array_stack( const array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> && std::is_nothrow_default_constructible_v<Storage> )
+  {
+    ConstructAtTop( rhs.Data(), rhs.top_ );
+  }
+
+  constexpr array_stack( array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> && std::is_nothrow_default_constructible_v<Storage> )
+  {
+    ConstructAtTop( MoveFrom( rhs.Data() ), rhs.top_ );
+  }
+
+  // Storage with a buffer of its own is copied, e.g. to copy its allocator, and a move
+  // takes the buffer, elements and all
+  constexpr array_stack( const array_stack& rhs )
+    requires BufferStorage<Storage> :
+    c_( rhs.c_ )
+  {
+    ConstructAtTop( rhs.Data(), rhs.top_ );
+  }
+
+  constexpr array_stack( array_stack&& rhs ) noexcept
+    requires BufferStorage<Storage> :
+    top_( std::exchange( rhs.top_, index_type( 0 ) ) ),
+    c_( std::move( rhs.c_ ) )
+  {
+  }
+
+  constexpr array_stack& operator=( const array_stack& rhs )
+    noexcept( std::is_nothrow_copy_assignable_v<T> && std::is_nothrow_copy_constructible_v<T> && NothrowResize )
+  {
+    if( this == &rhs )
+      return *this;
+    if constexpr( BufferStorage<Storage> )
+    {
+      // Storage may take the allocator of rhs, and with it a new buffer
+      clear();
+      c_ = rhs.c_;
+    }
+    Assign( rhs.Data(), rhs.top_ );
+    return *this;
+  }
+
+  constexpr array_stack& operator=( array_stack&& rhs )
+    noexcept( std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_constructible_v<T> && NothrowResize )
   {
+    if( this == &rhs )
+      return *this;
+    if constexpr( BufferStorage<Storage> )
+    {
+      // Take the buffer of rhs if the allocators allow it; rhs is left empty
+      clear();
+      if( StorageTake( c_, rhs.c_ ) )
+      {
+        std::swap( top_, rhs.top_ );
+        return *this;
+      }
+    }
+    Assign( MoveFrom( rhs.Data() ), rhs.top_ );
+    return *this;
+  }
+
+  constexpr ~array_stack()
+  {
+    clear();
   }
 
   constexpr iterator begin() noexcept
   {
-    return c_.begin();
+    return Data();
   }
 
   constexpr const_iterator begin() const noexcept
   {
-    return c_.begin();
+    return Data();
   }
 
   constexpr const_iterator cbegin() const noexcept
@@ -160,12 +757,14 @@ public:
 
   constexpr reverse_iterator rbegin() noexcept
   {
-    return c_.rbegin();
+    // reverse iteration starts at the top of the stack, not at Capacity
+    return reverse_iterator( end() );
   }
 
   constexpr const_reverse_iterator rbegin() const noexcept
   {
-    return c_.rbegin();
+    // reverse iteration starts at the top of the stack, not at Capacity
+    return const_reverse_iterator( end() );
   }
 
   constexpr const_reverse_iterator crbegin() const noexcept
@@ -175,14 +774,12 @@ public:
 
   constexpr reverse_iterator rend() noexcept
   {
-    // end of stack is top element, not Capacity
-    return rbegin() + static_cast<ptrdiff_t>( top_ );
+    return reverse_iterator( begin() );
   }
 
   constexpr const_reverse_iterator rend() const noexcept
   {
-    // end of stack is top element, not Capacity
-    return crbegin() + static_cast<ptrdiff_t>( top_ );
+    return const_reverse_iterator( begin() );
   }
 
   constexpr const_reverse_iterator crend() const noexcept
@@ -190,6 +787,18 @@ public:
     return rend();
   }
 
+  // Live elements from the top of the stack down to the bottom, e.g. for scope lookup:
+  // for( const auto& sym : stack.top_down() ) ...
+  constexpr std::ranges::subrange<reverse_iterator> top_down() noexcept
+  {
+    return { rbegin(), rend() };
+  }
+
+  constexpr std::ranges::subrange<const_reverse_iterator> top_down() const noexcept
+  {
+    return { rbegin(), rend() };
+  }
+
   constexpr bool empty() const noexcept
   {
     return top_ == 0;
@@ -210,174 +819,564 @@ public:
     return Capacity;
   }
 
+  // Bytes the stack occupies where it is stored, e.g. in a stack frame. Elements that the
+  // storage keeps elsewhere, like heap_array_stack's, aren't included.
+  static consteval size_type footprint_bytes() noexcept
+  {
+    return sizeof( array_stack );
+  }
+
   constexpr void clear() noexcept
   {
+    std::destroy( begin(), end() );
     top_ = 0;
+    StorageResize( c_, 0 );
   }
 
   constexpr reference top() PK_MAY_THROW
   {
-    CheckForEmptyStack();
-    return c_[top_-1];
+    CheckForEmptyStack(1);
+    return Data()[top_-1];
   }
 
   constexpr const_reference top() const PK_MAY_THROW
   {
-    CheckForEmptyStack();
-    return c_[top_-1];
+    CheckForEmptyStack(1);
+    return Data()[top_-1];
   }
 
-  constexpr void push( const value_type& v ) PK_MAY_THROW
+  constexpr void push( const value_type& v ) noexcept( OverflowNoexcept && NothrowConstruct<const T&> )
   {
-    CheckForFullStack(1);
-    c_[top_] = v;
+    if( CheckForFullStack(1) == 0 ) // dropped
+      return;
+    StorageResize( c_, top_ + 1u );
+    std::construct_at( Data() + top_, v );
     ++top_;
+    stats_.on_push( 1, top_, Capacity );
   }
 
-  constexpr void push( value_type&& v ) PK_MAY_THROW
+  constexpr void push( value_type&& v ) noexcept( OverflowNoexcept && NothrowConstruct<T&&> )
   {
-    CheckForFullStack(1);
-    c_[top_] = std::move( v );
+    if( CheckForFullStack(1) == 0 ) // dropped
+      return;
+    StorageResize( c_, top_ + 1u );
+    std::construct_at( Data() + top_, std::move( v ) );
     ++top_;
+    stats_.on_push( 1, top_, Capacity );
   }
 
   template <typename Range>
-  constexpr void push_range( Range&& rng ) PK_MAY_THROW
+  constexpr void push_range( Range&& rng ) noexcept( NothrowPushRange<Range> )
   {
-    CheckForFullStack( std::size( rng ) );
-    const auto dest = c_.data() + top_;
-    std::ranges::copy( rng, dest );
-    top_ += std::size( rng );
+    const auto count = CheckForFullStack( static_cast<size_type>( std::size( rng ) ) );
+    ConstructAtTop( ForwardFrom<T>( std::forward<Range>( rng ) ), count );
+    stats_.on_push( count, top_, Capacity );
   }
 
+  // Not available with overflow::drop_new, since a dropped element has no reference;
+  // use try_emplace() instead
   template <class... Types>
-  constexpr decltype(auto) emplace( Types&&... values ) PK_MAY_THROW
+    requires( !DropOnOverflow )
+  constexpr decltype(auto) emplace( Types&&... values ) noexcept( OverflowNoexcept && NothrowConstruct<Types...> )
   {
     CheckForFullStack(1);
-    const auto dest = c_.data() + top_;
-    std::construct_at( dest, std::forward<Types>( values )... );
+    StorageResize( c_, top_ + 1u );
+    const auto dest = std::construct_at( Data() + top_, std::forward<Types>( values )... );
+    ++top_;
+    stats_.on_push( 1, top_, Capacity );
+    return *dest;
+  }
+
+  // Non-throwing alternatives to push(), emplace() and push_range(). When the stack
+  // lacks room, nothing is constructed and the stack is unchanged; no asserts, no exceptions.
+
+  constexpr pointer try_push( const value_type& v )
+    noexcept( NothrowConstruct<const T&> )
+  {
+    return try_emplace( v );
+  }
+
+  constexpr pointer try_push( value_type&& v )
+    noexcept( NothrowConstruct<T&&> )
+  {
+    return try_emplace( std::move( v ) );
+  }
+
+  // Returns a pointer to the new element, or nullptr if the stack is full
+  template <class... Types>
+  constexpr pointer try_emplace( Types&&... values )
+    noexcept( NothrowConstruct<Types...> )
+  {
+    if( full() )
+    {
+      stats_.on_overflow();
+      return nullptr;
+    }
+    StorageResize( c_, top_ + 1u );
+    const auto dest = std::construct_at( Data() + top_, std::forward<Types>( values )... );
     ++top_;
+    stats_.on_push( 1, top_, Capacity );
+    return dest;
+  }
+
+  // Pushes either the entire range or nothing; returns false if the range doesn't fit
+  template <typename Range>
+  constexpr bool try_push_range( Range&& rng )
+  {
+    const auto count = static_cast<size_type>( std::size( rng ) );
+    if( count > ( capacity() - size() ) )
+    {
+      stats_.on_overflow();
+      return false;
+    }
+    ConstructAtTop( ForwardFrom<T>( std::forward<Range>( rng ) ), count );
+    stats_.on_push( count, top_, Capacity );
+    return true;
   }
 
   constexpr void pop() PK_MAY_THROW
   {
-    CheckForEmptyStack();
+    CheckForEmptyStack(1);
     --top_;
+    std::destroy_at( Data() + top_ );
+    StorageResize( c_, top_ );
+    stats_.on_pop(1);
   }
 
-  constexpr void swap( array_stack& rhs ) noexcept( std::is_nothrow_swappable<Array>::value )
+  // Remove the top count elements; O(1) for trivially destructible objects
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
   {
-    // Swap only what is necessary, not the entire arrays
-    const auto maxTop = std::max( top_, rhs.top_ );
-    for( size_t i = 0; i < maxTop; ++i )
-      std::swap( c_[i], rhs.c_[i] );
-    std::swap( top_, rhs.top_ );
+    CheckForEmptyStack( count );
+    DestroyTop( count );
   }
 
-  constexpr const_reference operator[]( size_type i ) const noexcept
+  // Move the top count elements to dest in pop order (top first), then remove them.
+  // Equivalent to count calls to top() and pop() but with a single check.
+  template <typename OutIt>
+  constexpr OutIt pop_into( OutIt dest, size_type count ) PK_MAY_THROW
   {
-    assert( i < size() );
-    return c_[i];
+    CheckForEmptyStack( count );
+    const auto first = std::make_reverse_iterator( end() );
+    dest = std::ranges::move( first, first + static_cast<ptrdiff_t>( count ), dest ).out;
+    DestroyTop( count );
+    return dest;
   }
 
-  constexpr reference operator[]( size_type i ) noexcept
+  // If the stack is not empty, move the top element into v, pop it and return true
+  constexpr bool try_pop( value_type& v )
+    noexcept( std::is_nothrow_move_assignable_v<T> )
   {
-    assert( i < size() );
-    return c_[i];
+    if( empty() )
+      return false;
+    v = std::move( Data()[top_-1] );
+    DestroyTop(1);
+    return true;
   }
 
-private:
+  // Remove the top element and return it by value
+  constexpr value_type top_and_pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    value_type v = std::move( Data()[top_-1] );
+    DestroyTop(1);
+    return v;
+  }
 
-  // Synthesize a comparison operation even for objects that don't support <=> operator.
-  // Used in operator<=> below
-  struct SynthThreeWay
+  // Position in the stack to return to with rewind(); see scoped_frame for pairing the two
+  // automatically. PK_ARRAY_STACK_DEBUG builds also record the stack that made the mark
+  // and, with the default storage, how often the top slot below the mark has been vacated,
+  // so rewinding to a mark that the stack has since been popped or rewound past asserts.
+  class marker
   {
-    template <typename U, typename V>
-    constexpr auto operator()( const U& lhs, const V& rhs ) const noexcept
-      requires requires
+  public:
+    constexpr size_type depth() const noexcept
+    {
+      return depth_;
+    }
+
+  private:
+    friend class array_stack;
+#if defined(PK_ARRAY_STACK_DEBUG)
+    constexpr marker( index_type depth, const array_stack* owner, uint32_t vacated ) noexcept :
+      depth_( depth ), owner_( owner ), vacated_( vacated )
+    {
+    }
+    index_type depth_;
+    const array_stack* owner_;
+    uint32_t vacated_;
+#else
+    constexpr explicit marker( index_type depth ) noexcept :
+      depth_( depth )
+    {
+    }
+    index_type depth_;
+#endif
+  };
+
+  // Marks the current top, e.g. on entering a scope whose locals are then pushed
+  constexpr marker mark() const noexcept
+  {
+#if defined(PK_ARRAY_STACK_DEBUG)
+    return marker( top_, this, VacatedBelow( top_ ) );
+#else
+    return marker( top_ );
+#endif
+  }
+
+  // Removes every element pushed since m was made, top first; O(1) for trivially
+  // destructible objects. m must come from this stack, which mustn't have gone below m since.
+  constexpr void rewind( marker m ) noexcept
+  {
+#if defined(PK_ARRAY_STACK_DEBUG)
+    PK_ASSERT( m.owner_ == this );
+    PK_ASSERT( m.depth_ <= top_ && m.vacated_ == VacatedBelow( m.depth_ ) );
+#endif
+    PK_ASSERT( m.depth_ <= top_ );
+    DestroyTop( top_ - m.depth_ );
+  }
+
+  constexpr void swap( array_stack& rhs )
+    noexcept( std::is_nothrow_swappable_v<T> && std::is_nothrow_move_constructible_v<T> && NothrowResize )
+  {
+    if constexpr( BufferStorage<Storage> )
+    {
+      if( StorageSwap( c_, rhs.c_ ) )
       {
-        { lhs < rhs } -> BooleanTestable;
-        { lhs > rhs } -> BooleanTestable;
+        std::swap( top_, rhs.top_ );
+        return;
       }
+    }
+    // Swap only what is necessary, not the entire arrays. Elements beyond the
+    // shorter stack are moved into place rather than swapped with dead slots.
+    const auto longest = std::max( top_, rhs.top_ );
+    StorageResize( c_, longest );
+    StorageResize( rhs.c_, longest );
+    if constexpr( std::is_trivially_copyable_v<T> )
     {
-      if constexpr( std::three_way_comparable_with<U, V> )
-        return lhs <=> rhs; // U supports operator <=>
-      else
-      { // implement <=> equivalent using existing < and > operators
-        if( lhs < rhs )
-          return std::strong_ordering::less;
-        if( lhs > rhs )
-          return std::strong_ordering::greater;
-        return std::strong_ordering::equal;
+      if( !std::is_constant_evaluated() )
+      {
+        SwapBytes( Data(), rhs.Data(), longest * sizeof( T ) );
+        std::swap( top_, rhs.top_ );
+        StorageResize( c_, top_ );
+        StorageResize( rhs.c_, rhs.top_ );
+        return;
       }
     }
-  };
+    auto& shorter = ( top_ < rhs.top_ ) ? *this : rhs;
+    auto& longer  = ( top_ < rhs.top_ ) ? rhs : *this;
+    for( size_t i = 0; i < shorter.top_; ++i )
+      std::swap( Data()[i], rhs.Data()[i] );
+    for( size_t i = shorter.top_; i < longer.top_; ++i )
+    {
+      std::construct_at( shorter.Data() + i, std::move( longer.Data()[i] ) );
+      std::destroy_at( longer.Data() + i );
+    }
+    std::swap( top_, rhs.top_ );
+    StorageResize( c_, top_ );
+    StorageResize( rhs.c_, rhs.top_ );
+  }
 
-public:
+  constexpr const_reference operator[]( size_type i ) const noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[i];
+  }
+
+  constexpr reference operator[]( size_type i ) noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[i];
+  }
+
+  // Copy of the live elements in a stack of maximum size N >= size(). At compile time,
+  // N can be the size of a constexpr stack, giving an exactly sized table:
+  //   constexpr auto table = stack.shrink_to_fit<stack.size()>();
+  template <size_t N>
+  constexpr array_stack<T, N> shrink_to_fit() const
+    noexcept( noexcept( std::declval<array_stack<T, N>&>().push_range( std::declval<const array_stack&>() ) ) )
+  {
+    array_stack<T, N> result;
+    result.push_range( *this );
+    return result;
+  }
+
+  constexpr bool contains( const value_type& v ) const noexcept
+  {
+    return FindFirst( Data(), top_, v ) != top_;
+  }
+
+  // Topmost element equal to v, or end() if there is none
+  constexpr iterator find_from_top( const value_type& v ) noexcept
+  {
+    return begin() + FindLast( Data(), top_, v );
+  }
+
+  constexpr const_iterator find_from_top( const value_type& v ) const noexcept
+  {
+    return begin() + FindLast( Data(), top_, v );
+  }
+
+  // The live elements as raw bytes, for writing in a single call; see array_stack_snapshot.h
+  std::span<const std::byte> as_bytes() const noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    return std::as_bytes( std::span<const T>( Data(), top_ ) );
+  }
+
+  // Replace the stack contents with the elements in bytes, as written from as_bytes(), with
+  // a single memcpy. Returns false, leaving the stack unchanged, unless bytes holds a whole
+  // number of elements that fit.
+  bool from_bytes( std::span<const std::byte> bytes ) noexcept( NothrowResize )
+    requires std::is_trivially_copyable_v<T>
+  {
+    if( bytes.size() % sizeof( T ) != 0 || bytes.size() / sizeof( T ) > Capacity )
+      return false;
+    const auto count = bytes.size() / sizeof( T );
+    StorageResize( c_, count );
+    if( count > 0 )
+      std::memcpy( Data(), bytes.data(), bytes.size() );
+    top_ = static_cast<index_type>( count ); // trivially copyable implies trivially destructible
+    return true;
+  }
+
+  // Stable references, for storage that counts the reuse of each slot, like that of
+  // handle_array_stack: handle( i ) names the element at index i, and get() returns that
+  // element, or nullptr once it has been popped, even if another now occupies its slot
+  constexpr auto handle( size_type i ) const noexcept
+    requires requires( const Storage& storage ) { StorageHandle( storage, i ); }
+  {
+    PK_ASSERT( i < size() );
+    return StorageHandle( c_, i );
+  }
+
+  template <typename Handle>
+  constexpr pointer get( const Handle& h ) noexcept
+    requires requires( const Storage& storage ) { StorageIndex( storage, h ); }
+  {
+    const size_t i = StorageIndex( c_, h ); // Capacity if h is stale
+    return ( i < top_ ) ? Data() + i : nullptr;
+  }
+
+  template <typename Handle>
+  constexpr const_pointer get( const Handle& h ) const noexcept
+    requires requires( const Storage& storage ) { StorageIndex( storage, h ); }
+  {
+    const size_t i = StorageIndex( c_, h );
+    return ( i < top_ ) ? Data() + i : nullptr;
+  }
+
+  // Statistics recorded by Traits::stats_type for this stack, e.g. stats().high_water_mark()
+  constexpr const stats_type& stats() const noexcept
+  {
+    return stats_;
+  }
 
   constexpr bool operator==( const array_stack& rhs ) const noexcept
   {
     if( top_ != rhs.top_ ) // different sized stacks are not equal
       return false;
-    const auto start = c_.data();
-    const auto end = start + top_;
-    return std::equal( start, end, rhs.c_.data() );
+    return EqualElements( Data(), rhs.Data(), top_ );
   }
 
   constexpr auto operator<=>( const array_stack& rhs ) const noexcept
   {
     // Can't use std::array::operator<=> because must only compare a subset of elements
-    const auto lhsStart = c_.data();
-    const auto lhsEnd = lhsStart + top_;
-    const auto rhsStart = rhs.c_.data();
-    const auto rhsEnd = rhsStart + rhs.top_;
-    return std::lexicographical_compare_three_way( lhsStart, lhsEnd, 
-                                                   rhsStart, rhsEnd, SynthThreeWay{} );
+    return CompareElements( Data(), top_, rhs.Data(), rhs.top_ );
   }
 
 private:
 
-  void CheckForEmptyStack() const
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
   {
-#if defined(PK_ENABLE_EXCEPTIONS)
-    if( empty() )
-      throw std::out_of_range( "empty stack" );
-#else
-    assert( !empty() );
-#endif
+    CheckElementsToRemove( elementsToRemove, size() );
   }
 
-  void CheckForFullStack( [[maybe_unused]] size_t elementsToAdd ) const
+  // Applies the overflow policy; returns how many of elementsToAdd to push
+  constexpr size_t CheckForFullStack( size_t elementsToAdd ) noexcept( OverflowNoexcept )
   {
-#if defined(PK_ENABLE_EXCEPTIONS)
     if( ( size() + elementsToAdd ) > capacity() )
-      throw std::out_of_range( "stack overflow" );
-#else
-    assert( ( size() + elementsToAdd ) <= capacity() );
-#endif
+      stats_.on_overflow();
+    return CheckElementsToAdd<Overflow>( elementsToAdd, size(), capacity() );
+  }
+
+  constexpr pointer Data() noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  // Times the slot below depth has been vacated; a stack that went below a marker has
+  // vacated the slot below it since
+  constexpr uint32_t VacatedBelow( size_type depth ) const noexcept
+  {
+    return ( depth == 0 ) ? 0 : StorageVacated( c_, depth - 1 );
+  }
+
+  constexpr const_pointer Data() const noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  // Construct count elements from first into the uninitialized slots at the top of the stack
+  template <typename InIt>
+  constexpr void ConstructAtTop( InIt first, size_type count )
+  {
+    if constexpr( IsMoveIterator<InIt> && std::is_trivially_copyable_v<T> )
+    {
+      // Moving trivially copyable objects copies them, possibly with memcpy
+      ConstructAtTop( first.base(), count );
+      return;
+    }
+    StorageResize( c_, top_ + count );
+    if constexpr( BitwiseCopyableFrom<InIt, T> )
+    {
+      if( !std::is_constant_evaluated() )
+      {
+        if( count > 0 )
+          std::memcpy( Data() + top_, std::to_address( first ), count * sizeof( T ) );
+        top_ += static_cast<index_type>( count );
+        return;
+      }
+    }
+    if constexpr( TrivialStorage<T> )
+      std::copy_n( first, count, Data() + top_ );
+    else if( !std::is_constant_evaluated() )
+      std::uninitialized_copy_n( first, count, Data() + top_ );
+    else // std::uninitialized_copy_n isn't constexpr
+    {
+      auto dest = Data() + top_;
+      for( size_type i = 0; i < count; ++i, ++first, ++dest )
+        std::construct_at( dest, *first );
+    }
+    top_ += static_cast<index_type>( count );
+  }
+
+  // Destroy the top count elements, top first, as count calls to pop() would
+  constexpr void DestroyTop( size_type count ) noexcept
+  {
+    if constexpr( !std::is_trivially_destructible_v<T> )
+      std::destroy( rbegin(), rbegin() + static_cast<ptrdiff_t>( count ) );
+    top_ -= static_cast<index_type>( count );
+    StorageResize( c_, top_ );
+    stats_.on_pop( count );
+  }
+
+  // Replace the stack contents with count elements from first, assigning over live
+  // elements and constructing or destroying the remainder as required
+  template <typename InIt>
+  constexpr void Assign( InIt first, size_type count )
+  {
+    if constexpr( BitwiseCopyableFrom<InIt, T> )
+    {
+      if( !std::is_constant_evaluated() )
+      {
+        top_ = 0; // trivially copyable implies trivially destructible
+        ConstructAtTop( first, count );
+        return;
+      }
+    }
+    const auto common = std::min<size_type>( top_, count );
+    first = std::ranges::copy_n( first, static_cast<ptrdiff_t>( common ), Data() ).in;
+    if( count > top_ )
+      ConstructAtTop( first, count - top_ );
+    else
+    {
+      std::destroy( Data() + count, Data() + top_ );
+      top_ = static_cast<index_type>( count );
+      StorageResize( c_, top_ );
+    }
+  }
+
+  // Trivially copyable objects are "moved" by copying them, which enables memcpy
+  static constexpr auto MoveFrom( pointer p ) noexcept
+  {
+    if constexpr( std::is_trivially_copyable_v<T> )
+      return p;
+    else
+      return std::make_move_iterator( p );
   }
 
 private:
 
   // top_ points to where the *next* element will be pushed
-  // push(x) -> c_[top_] = x; ++top_;
-  // pop()   -> --top_;
+  // push(x) -> construct c_[top_] from x; ++top_;
+  // pop()   -> --top_; destroy c_[top_];
   // top()   -> return c_[top_-1];
   // empty() -> return top_ == 0;
   // end()   -> return c_ + top_;
 
-  size_t top_ = 0;
-  Array c_;
+  alignas( Traits::alignment ) alignas( index_type ) index_type top_ = 0;
+  alignas( Traits::alignment ) alignas( Storage ) Storage c_;
+  PK_NO_UNIQUE_ADDRESS Stats stats_; // per-instance; not copied
 
 }; // class array_stack
 
 template <typename T, size_t Capacity>
-void constexpr swap( array_stack<T, Capacity>& lhs, 
-                     array_stack<T, Capacity>& rhs ) noexcept( noexcept( lhs.swap( rhs ) ) )
+using aligned_array_stack = array_stack<T, Capacity, aligned_array_stack_traits<T, Capacity>>;
+
+template <typename T, size_t Capacity, typename Traits>
+void constexpr swap( array_stack<T, Capacity, Traits>& lhs, 
+                     array_stack<T, Capacity, Traits>& rhs ) noexcept( noexcept( lhs.swap( rhs ) ) )
 {
   lhs.swap( rhs );
 }
 
-} // namespace PKIsensee
+// Marks a stack on construction and rewinds it to the mark on destruction, removing
+// everything pushed in between, e.g. for the locals of an interpreter scope:
+//
+//   {
+//     scoped_frame frame( locals );
+//     locals.push( x ); ...
+//   } // locals are back where they were
+template <typename Stack>
+class scoped_frame
+{
+public:
 
-///////////////////////////////////////////////////////////////////////////////
+  constexpr explicit scoped_frame( Stack& s ) noexcept :
+    stack_( s ),
+    mark_( s.mark() )
+  {
+  }
+
+  scoped_frame( const scoped_frame& ) = delete;
+  scoped_frame& operator=( const scoped_frame& ) = delete;
+
+  constexpr ~scoped_frame()
+  {
+    stack_.rewind( mark_ );
+  }
+
+  constexpr typename Stack::marker mark() const noexcept
+  {
+    return mark_;
+  }
+
+private:
+
+  Stack& stack_;
+  typename Stack::marker mark_;
+
+}; // class scoped_frame
+
+// Stack of exactly the given elements, pushed in order so the last is on top. The
+// element type is T, or the common type of the arguments if T is not specified.
+template <typename T = void, typename... Args>
+constexpr auto make_array_stack( Args&&... args )
+{
+  using V = std::conditional_t<std::is_void_v<T>, std::common_type_t<std::decay_t<Args>...>, T>;
+  array_stack<V, sizeof...( Args )> result;
+  ( result.push( std::forward<Args>( args ) ), ... );
+  return result;
+}
+
+// Evaluates Builder, a function returning an array_stack, at compile time and returns
+// the result as an exactly sized stack:
+//   constexpr auto table = make_array_stack_from<[]{ array_stack<int, 64> s; ...; return s; }>();
+template <auto Builder>
+consteval auto make_array_stack_from()
+{
+  constexpr auto built = Builder();
+  return built.template shrink_to_fit<built.size()>();
+}
+
+} // namespace PKIsensee
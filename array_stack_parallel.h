@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_parallel.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  Parallel algorithms over the live elements of an array_stack, or of any other
+//  random access range such as a heap_array_stack or ring_array_stack:
+//
+//    parallel::for_each( frames, []( Frame& f ) { f.Rescan(); } );
+//    auto cost = parallel::transform_reduce( frames, 0.0, std::plus{}, &Frame::Cost );
+//    auto it = parallel::find_if( frames, IsStale );
+//    parallel::sort( frames, ByDepth );
+//
+//  Elements are split into chunks of whole cache lines that worker threads claim
+//  one at a time, so threads never write to the same line of a cache-line
+//  aligned stack. Ranges below a threshold run serially on the calling thread,
+//  since starting threads costs more than scanning a few thousand elements.
+//  The calling thread always takes part. As with std::execution::par, an
+//  exception escaping a function called on a worker thread calls std::terminate.
+//
+//  Unlike the std::execution overloads, these don't depend on a parallel backend
+//  being present in the standard library.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+namespace parallel
+{
+
+struct options
+{
+  // Bytes of elements in each unit of work, rounded up to whole cache lines
+  size_t chunk_bytes = 64 * CacheLine;
+
+  // Ranges with fewer elements than this run serially
+  size_t serial_threshold = 16384;
+
+  // Maximum number of threads including the calling thread; 0 for one per hardware thread
+  unsigned max_threads = 0;
+};
+
+} // namespace parallel
+
+} // namespace PKIsensee
+
+namespace // anonymous
+{
+
+// Elements per chunk: at least one cache line, and a whole number of cache lines when
+// elements divide a cache line evenly
+template <typename T>
+constexpr size_t ChunkSize( const PKIsensee::parallel::options& opt ) noexcept
+{
+  const auto bytes = std::max( ( opt.chunk_bytes + CacheLine - 1 ) / CacheLine, size_t( 1 ) ) * CacheLine;
+  return std::max( bytes / sizeof( T ), size_t( 1 ) );
+}
+
+inline unsigned ThreadCount( const PKIsensee::parallel::options& opt, size_t chunkCount ) noexcept
+{
+  const auto hardware = std::max( std::thread::hardware_concurrency(), 1u );
+  const auto limit = ( opt.max_threads == 0 ) ? hardware : opt.max_threads;
+  return static_cast<unsigned>( std::min<size_t>( limit, chunkCount ) );
+}
+
+// Calls task( i ) for every i in [0, taskCount) from up to threadCount threads, including
+// this one, which claim tasks in order; returns when every task is done. Tasks are
+// skipped once stop( i ) is true, which lets searches finish early.
+template <typename Task, typename Stop>
+void ForkJoin( size_t taskCount, unsigned threadCount, Task&& task, Stop&& stop )
+{
+  std::atomic<size_t> next{ 0 };
+  auto worker = [&]
+  {
+    for( auto i = next.fetch_add( 1, std::memory_order_relaxed ); i < taskCount;
+              i = next.fetch_add( 1, std::memory_order_relaxed ) )
+    {
+      if( !stop( i ) )
+        task( i );
+    }
+  };
+  std::vector<std::jthread> helpers;
+  helpers.reserve( threadCount - 1 );
+  for( unsigned t = 1; t < threadCount; ++t )
+    helpers.emplace_back( worker );
+  worker();
+} // helpers join on destruction
+
+template <typename Task>
+void ForkJoin( size_t taskCount, unsigned threadCount, Task&& task )
+{
+  ForkJoin( taskCount, threadCount, std::forward<Task>( task ), []( size_t ) { return false; } );
+}
+
+// True if count elements in chunks of chunk elements aren't worth splitting between threads
+inline bool RunSerially( size_t count, size_t chunk, const PKIsensee::parallel::options& opt ) noexcept
+{
+  return count < std::max( opt.serial_threshold, size_t( 2 ) ) || count <= chunk ||
+         ThreadCount( opt, 2 ) < 2;
+}
+
+// Calls body( lo, hi, i ) for each chunk [lo, hi) of the count elements from first, where
+// i is the chunk index, and chunks are claimed in order. Chunks are skipped once stop( i ) is true.
+template <typename It, typename Body, typename Stop>
+void ForEachChunk( It first, size_t count, size_t chunk, const PKIsensee::parallel::options& opt,
+                   Body&& body, Stop&& stop )
+{
+  const auto chunkCount = ( count + chunk - 1 ) / chunk;
+  ForkJoin( chunkCount, ThreadCount( opt, chunkCount ), [&]( size_t i )
+  {
+    const auto lo = static_cast<ptrdiff_t>( i * chunk );
+    const auto hi = static_cast<ptrdiff_t>( std::min( count, ( i + 1 ) * chunk ) );
+    body( first + lo, first + hi, i );
+  }, std::forward<Stop>( stop ) );
+}
+
+template <typename It, typename Body>
+void ForEachChunk( It first, size_t count, size_t chunk, const PKIsensee::parallel::options& opt,
+                   Body&& body )
+{
+  ForEachChunk( first, count, chunk, opt, std::forward<Body>( body ), []( size_t ) { return false; } );
+}
+
+}; // namespace anonymous
+
+namespace PKIsensee
+{
+
+namespace parallel
+{
+
+// Calls f once for every live element, in no particular order
+template <std::ranges::random_access_range Range, typename F>
+  requires std::ranges::sized_range<Range>
+void for_each( Range&& rng, F f, const options& opt = {} )
+{
+  const auto count = static_cast<size_t>( std::ranges::size( rng ) );
+  const auto chunk = ChunkSize<std::ranges::range_value_t<Range>>( opt );
+  if( RunSerially( count, chunk, opt ) )
+  {
+    std::ranges::for_each( rng, std::ref( f ) );
+    return;
+  }
+  ForEachChunk( std::ranges::begin( rng ), count, chunk, opt,
+                [&]( auto lo, auto hi, size_t ) { std::for_each( lo, hi, std::ref( f ) ); } );
+}
+
+// reduce( init, transform( e ) ) over every live element e; reduce must be associative
+// and commutative, as for std::transform_reduce
+template <std::ranges::random_access_range Range, typename U, typename Reduce, typename Transform>
+  requires std::ranges::sized_range<Range>
+U transform_reduce( Range&& rng, U init, Reduce reduce, Transform transform, const options& opt = {} )
+{
+  auto serial = [&]( auto lo, auto hi, U sum )
+  {
+    for( ; lo != hi; ++lo )
+      sum = std::invoke( reduce, std::move( sum ), std::invoke( transform, *lo ) );
+    return sum;
+  };
+  const auto count = static_cast<size_t>( std::ranges::size( rng ) );
+  const auto chunk = ChunkSize<std::ranges::range_value_t<Range>>( opt );
+  if( RunSerially( count, chunk, opt ) )
+    return serial( std::ranges::begin( rng ), std::ranges::end( rng ), std::move( init ) );
+
+  // One partial sum per chunk, combined in chunk order once every chunk is done
+  std::vector<std::optional<U>> partials( ( count + chunk - 1 ) / chunk );
+  ForEachChunk( std::ranges::begin( rng ), count, chunk, opt, [&]( auto lo, auto hi, size_t i )
+  {
+    partials[i].emplace( serial( lo + 1, hi, U( std::invoke( transform, *lo ) ) ) );
+  } );
+  for( auto& partial : partials )
+    init = std::invoke( reduce, std::move( init ), std::move( *partial ) );
+  return init;
+}
+
+// First live element, from the bottom of the stack, for which pred is true, or end()
+template <std::ranges::random_access_range Range, typename Pred>
+  requires std::ranges::sized_range<Range>
+std::ranges::borrowed_iterator_t<Range> find_if( Range&& rng, Pred pred, const options& opt = {} )
+{
+  const auto count = static_cast<size_t>( std::ranges::size( rng ) );
+  const auto chunk = ChunkSize<std::ranges::range_value_t<Range>>( opt );
+  if( RunSerially( count, chunk, opt ) )
+    return std::ranges::find_if( rng, std::ref( pred ) );
+
+  // Chunks are claimed in order, so those beyond the earliest match so far are skipped
+  const auto first = std::ranges::begin( rng );
+  std::atomic<size_t> found{ count };
+  ForEachChunk( first, count, chunk, opt, [&]( auto lo, auto hi, size_t )
+  {
+    const auto it = std::find_if( lo, hi, std::ref( pred ) );
+    if( it == hi )
+      return;
+    const auto index = static_cast<size_t>( it - first );
+    auto current = found.load( std::memory_order_relaxed );
+    while( index < current && !found.compare_exchange_weak( current, index, std::memory_order_relaxed ) )
+      ;
+  },
+  [&]( size_t i ) { return i * chunk > found.load( std::memory_order_relaxed ); } );
+  return first + static_cast<ptrdiff_t>( found.load( std::memory_order_relaxed ) );
+}
+
+// Sorts the live elements in place: chunks are sorted in parallel, then merged pairwise
+// in parallel rounds. Not stable.
+template <std::ranges::random_access_range Range, typename Compare = std::ranges::less>
+  requires std::ranges::sized_range<Range> &&
+           std::sortable<std::ranges::iterator_t<Range>, Compare>
+void sort( Range&& rng, Compare comp = {}, const options& opt = {} )
+{
+  const auto count = static_cast<size_t>( std::ranges::size( rng ) );
+  const auto chunk = ChunkSize<std::ranges::range_value_t<Range>>( opt );
+  if( RunSerially( count, chunk, opt ) )
+  {
+    std::ranges::sort( rng, std::ref( comp ) );
+    return;
+  }
+  const auto first = std::ranges::begin( rng );
+  ForEachChunk( first, count, chunk, opt,
+                [&]( auto lo, auto hi, size_t ) { std::sort( lo, hi, std::ref( comp ) ); } );
+  for( auto width = chunk; width < count; width *= 2 )
+  {
+    // Merge sorted runs [lo, mid) and [mid, hi) of width elements each
+    const auto pairs = ( count + 2 * width - 1 ) / ( 2 * width );
+    ForkJoin( pairs, ThreadCount( opt, pairs ), [&]( size_t i )
+    {
+      const auto lo = i * 2 * width;
+      const auto mid = std::min( count, lo + width );
+      const auto hi = std::min( count, lo + 2 * width );
+      std::inplace_merge( first + static_cast<ptrdiff_t>( lo ), first + static_cast<ptrdiff_t>( mid ),
+                          first + static_cast<ptrdiff_t>( hi ), std::ref( comp ) );
+    } );
+  }
+}
+
+// Reorders the live elements so that those for which pred is true come first; returns
+// the first element of the second group. Not stable.
+template <std::ranges::random_access_range Range, typename Pred>
+  requires std::ranges::sized_range<Range> && std::permutable<std::ranges::iterator_t<Range>>
+std::ranges::borrowed_iterator_t<Range> partition( Range&& rng, Pred pred, const options& opt = {} )
+{
+  const auto count = static_cast<size_t>( std::ranges::size( rng ) );
+  const auto chunk = ChunkSize<std::ranges::range_value_t<Range>>( opt );
+  if( RunSerially( count, chunk, opt ) )
+    return std::ranges::partition( rng, std::ref( pred ) ).begin();
+
+  // Partition each chunk, then join neighboring blocks in parallel rounds by rotating the
+  // false part of the left block past the true part of the right block
+  const auto first = std::ranges::begin( rng );
+  std::vector<size_t> trueCounts( ( count + chunk - 1 ) / chunk );
+  ForEachChunk( first, count, chunk, opt, [&]( auto lo, auto hi, size_t i )
+  {
+    trueCounts[i] = static_cast<size_t>( std::partition( lo, hi, std::ref( pred ) ) - lo );
+  } );
+  for( size_t blocks = 1; blocks < trueCounts.size(); blocks *= 2 )
+  {
+    const auto pairs = ( trueCounts.size() + 2 * blocks - 1 ) / ( 2 * blocks );
+    ForkJoin( pairs, ThreadCount( opt, pairs ), [&]( size_t i )
+    {
+      const auto left = i * 2 * blocks;
+      const auto right = left + blocks;
+      if( right >= trueCounts.size() )
+        return;
+      const auto lo = first + static_cast<ptrdiff_t>( left * chunk + trueCounts[left] );
+      const auto mid = first + static_cast<ptrdiff_t>( right * chunk );
+      std::rotate( lo, mid, mid + static_cast<ptrdiff_t>( trueCounts[right] ) );
+      trueCounts[left] += trueCounts[right];
+    } );
+  }
+  return first + static_cast<ptrdiff_t>( trueCounts.front() );
+}
+
+} // namespace parallel
+
+} // namespace PKIsensee
@@ -0,0 +1,216 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_pool.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  array_stack_pool<T, Capacity, N> owns N array_stack<T, Capacity> objects,
+//  constructed once, and hands them out to any number of threads in O(1).
+//
+//  Temporary stacks taken from a pool are already constructed and their memory is
+//  likely warm in cache; released stacks are cleared, which destroys nothing for
+//  trivially destructible T. Free stacks are linked into a lock-free Treiber stack
+//  of indices with a tagged head, the TaggedIndexList of concurrent_array_stack.
+//  Each stack is padded to whole cache lines, so stacks used by different threads
+//  never share one.
+//
+//  A thread that acquires and releases stacks at a high rate can go through a
+//  local_cache, which keeps a few free stacks for that thread alone and only
+//  touches the shared free list to refill or drain half of its entries:
+//
+//    array_stack_pool<Token, 1024, 64> pool;
+//    thread_local array_stack_pool<Token, 1024, 64>::local_cache<> cache( pool );
+//    auto tokens = cache.acquire(); // returned to the cache at scope exit
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include "concurrent_array_stack.h"
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity, size_t N> // N stacks of objects T; maximum size Capacity
+class array_stack_pool
+{
+  using Index = TaggedIndexList::Index;
+  static_assert( N > 0 && N < std::numeric_limits<Index>::max(),
+                 "N must fit in a 32-bit index" );
+
+  // Returns a stack to Owner, a pool or a local_cache, when a handle is destroyed
+  template <typename Owner>
+  struct Releaser
+  {
+    Owner* owner = nullptr;
+
+    void operator()( array_stack<T, Capacity>* s ) const noexcept
+    {
+      owner->release( s );
+    }
+  };
+
+public:
+
+  using stack_type              = array_stack<T, Capacity>;
+  using size_type               = size_t;
+  using handle                  = std::unique_ptr<stack_type, Releaser<array_stack_pool>>;
+
+  array_stack_pool() noexcept
+  {
+    // Initially every stack is free
+    for( Index i = 0; i < N; ++i )
+      next_[i].store( i + 1, std::memory_order_relaxed );
+    next_[N-1].store( Null, std::memory_order_relaxed );
+  }
+
+  array_stack_pool( const array_stack_pool& ) = delete;
+  array_stack_pool& operator=( const array_stack_pool& ) = delete;
+
+  static constexpr size_type size() noexcept
+  {
+    return N;
+  }
+
+  // Any thread. Returns an empty stack, or nullptr if every stack is in use.
+  stack_type* try_acquire() noexcept
+  {
+    const auto index = free_.pop( Links() );
+    return ( index == Null ) ? nullptr : Stack( index );
+  }
+
+  // Any thread. As try_acquire(), but the stack is released when the handle is destroyed.
+  handle acquire() noexcept
+  {
+    return handle( try_acquire(), { this } );
+  }
+
+  // Any thread. s must have come from this pool.
+  void release( stack_type* s ) noexcept
+  {
+    s->clear();
+    free_.push( StackIndex( s ), Links() );
+  }
+
+  // Free stacks reserved for a single thread
+  template <size_t CacheSize = 8>
+  class local_cache
+  {
+    static_assert( CacheSize >= 2, "CacheSize must be at least 2" );
+
+  public:
+
+    using handle = std::unique_ptr<stack_type, Releaser<local_cache>>;
+
+    explicit local_cache( array_stack_pool& pool ) noexcept :
+      pool_( pool )
+    {
+    }
+
+    local_cache( const local_cache& ) = delete;
+    local_cache& operator=( const local_cache& ) = delete;
+
+    ~local_cache()
+    {
+      Drain( count_ );
+    }
+
+    // Returns an empty stack, or nullptr if the cache is empty and so is the pool
+    stack_type* try_acquire() noexcept
+    {
+      if( count_ == 0 )
+        Refill();
+      return ( count_ == 0 ) ? nullptr : pool_.Stack( cached_[--count_] );
+    }
+
+    handle acquire() noexcept
+    {
+      return handle( try_acquire(), { this } );
+    }
+
+    // s must have come from the same pool, through any cache
+    void release( stack_type* s ) noexcept
+    {
+      s->clear();
+      if( count_ == CacheSize )
+        Drain( CacheSize / 2 );
+      cached_[count_++] = pool_.StackIndex( s );
+    }
+
+  private:
+
+    void Refill() noexcept
+    {
+      while( count_ < CacheSize / 2 )
+      {
+        const auto index = pool_.free_.pop( pool_.Links() );
+        if( index == Null )
+          return;
+        cached_[count_++] = index;
+      }
+    }
+
+    void Drain( size_t count ) noexcept
+    {
+      for( ; count > 0; --count )
+        pool_.free_.push( cached_[--count_], pool_.Links() );
+    }
+
+  private:
+
+    array_stack_pool& pool_;
+    size_t count_ = 0;
+    Index cached_[CacheSize];
+
+  }; // class local_cache
+
+private:
+
+  static constexpr Index Null = TaggedIndexList::Null;
+
+  // Each stack is alone on its cache lines, so threads using neighboring stacks, or
+  // the free list, don't falsely share
+  struct alignas( CacheLine ) PaddedStack
+  {
+    stack_type stack;
+  };
+
+  stack_type* Stack( Index index ) noexcept
+  {
+    return &stacks_[index].stack;
+  }
+
+  Index StackIndex( const stack_type* s ) const noexcept
+  {
+    const auto offset = reinterpret_cast<uintptr_t>( s ) - reinterpret_cast<uintptr_t>( &stacks_[0].stack );
+    assert( offset % sizeof( PaddedStack ) == 0 && offset / sizeof( PaddedStack ) < N );
+    return static_cast<Index>( offset / sizeof( PaddedStack ) );
+  }
+
+  auto Links() noexcept
+  {
+    return [this]( Index i ) -> std::atomic<Index>& { return next_[i]; };
+  }
+
+private:
+
+  // The free list head is the only contended data, so it gets its own cache line
+
+  alignas( CacheLine ) TaggedIndexList free_ { 0 };
+  alignas( CacheLine ) std::array<std::atomic<Index>, N> next_;
+  std::array<PaddedStack, N> stacks_;
+
+}; // class array_stack_pool
+
+} // namespace PKIsensee
@@ -0,0 +1,372 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_simd.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  Search and comparison kernels over runs of contiguous elements, used by
+//  array_stack and related containers.
+//
+//  For arithmetic elements the kernels compare a full vector register of elements
+//  at a time using the best instruction set enabled at compile time: AVX-512BW,
+//  AVX2, SSE2 or NEON. The remaining tail is handled one element at a time, so no
+//  kernel ever reads outside the live elements. Other types, constant evaluation
+//  and builds with PK_DISABLE_SIMD defined use the scalar loop.
+//
+//  Floating-point elements are compared with ==, exactly as the scalar loop does:
+//  NaN never matches and +0.0 matches -0.0.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(PK_DISABLE_SIMD)
+  // scalar kernels only
+#elif defined(__AVX512BW__)
+  #include <immintrin.h>
+  #define PK_SIMD_AVX512 1
+  #define PK_SIMD 1
+#elif defined(__AVX2__)
+  #include <immintrin.h>
+  #define PK_SIMD_AVX2 1
+  #define PK_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+  #include <emmintrin.h>
+  #define PK_SIMD_SSE2 1
+  #define PK_SIMD 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define PK_SIMD_NEON 1
+  #define PK_SIMD 1
+#endif
+
+namespace // anonymous
+{
+
+// SimdEqualMask<T>() compares vectors of elements, returning a mask with
+// SimdBitsPerLane<T> bits set for each element that compares equal
+
+#if defined(PK_SIMD_AVX512)
+
+using SimdVec = __m512i;
+constexpr size_t SimdBytes = 64;
+
+template <typename T>
+constexpr size_t SimdBitsPerLane = 1;
+
+inline SimdVec SimdLoad( const void* p ) noexcept
+{
+  return _mm512_loadu_si512( p );
+}
+
+template <typename T>
+uint64_t SimdEqualMask( SimdVec a, SimdVec b ) noexcept
+{
+  if constexpr( std::is_same_v<T, float> )
+    return _mm512_cmp_ps_mask( _mm512_castsi512_ps( a ), _mm512_castsi512_ps( b ), _CMP_EQ_OQ );
+  else if constexpr( std::is_same_v<T, double> )
+    return _mm512_cmp_pd_mask( _mm512_castsi512_pd( a ), _mm512_castsi512_pd( b ), _CMP_EQ_OQ );
+  else if constexpr( sizeof( T ) == 1 )
+    return _mm512_cmpeq_epi8_mask( a, b );
+  else if constexpr( sizeof( T ) == 2 )
+    return _mm512_cmpeq_epi16_mask( a, b );
+  else if constexpr( sizeof( T ) == 4 )
+    return _mm512_cmpeq_epi32_mask( a, b );
+  else
+    return _mm512_cmpeq_epi64_mask( a, b );
+}
+
+#elif defined(PK_SIMD_AVX2)
+
+using SimdVec = __m256i;
+constexpr size_t SimdBytes = 32;
+
+template <typename T>
+constexpr size_t SimdBitsPerLane = sizeof( T ); // movemask yields a bit per byte
+
+inline SimdVec SimdLoad( const void* p ) noexcept
+{
+  return _mm256_loadu_si256( static_cast<const __m256i*>( p ) );
+}
+
+template <typename T>
+uint64_t SimdEqualMask( SimdVec a, SimdVec b ) noexcept
+{
+  SimdVec eq;
+  if constexpr( std::is_same_v<T, float> )
+    eq = _mm256_castps_si256( _mm256_cmp_ps( _mm256_castsi256_ps( a ), _mm256_castsi256_ps( b ), _CMP_EQ_OQ ) );
+  else if constexpr( std::is_same_v<T, double> )
+    eq = _mm256_castpd_si256( _mm256_cmp_pd( _mm256_castsi256_pd( a ), _mm256_castsi256_pd( b ), _CMP_EQ_OQ ) );
+  else if constexpr( sizeof( T ) == 1 )
+    eq = _mm256_cmpeq_epi8( a, b );
+  else if constexpr( sizeof( T ) == 2 )
+    eq = _mm256_cmpeq_epi16( a, b );
+  else if constexpr( sizeof( T ) == 4 )
+    eq = _mm256_cmpeq_epi32( a, b );
+  else
+    eq = _mm256_cmpeq_epi64( a, b );
+  return static_cast<uint32_t>( _mm256_movemask_epi8( eq ) );
+}
+
+#elif defined(PK_SIMD_SSE2)
+
+using SimdVec = __m128i;
+constexpr size_t SimdBytes = 16;
+
+template <typename T>
+constexpr size_t SimdBitsPerLane = sizeof( T ); // movemask yields a bit per byte
+
+inline SimdVec SimdLoad( const void* p ) noexcept
+{
+  return _mm_loadu_si128( static_cast<const __m128i*>( p ) );
+}
+
+template <typename T>
+uint64_t SimdEqualMask( SimdVec a, SimdVec b ) noexcept
+{
+  SimdVec eq;
+  if constexpr( std::is_same_v<T, float> )
+    eq = _mm_castps_si128( _mm_cmpeq_ps( _mm_castsi128_ps( a ), _mm_castsi128_ps( b ) ) );
+  else if constexpr( std::is_same_v<T, double> )
+    eq = _mm_castpd_si128( _mm_cmpeq_pd( _mm_castsi128_pd( a ), _mm_castsi128_pd( b ) ) );
+  else if constexpr( sizeof( T ) == 1 )
+    eq = _mm_cmpeq_epi8( a, b );
+  else if constexpr( sizeof( T ) == 2 )
+    eq = _mm_cmpeq_epi16( a, b );
+  else if constexpr( sizeof( T ) == 4 )
+    eq = _mm_cmpeq_epi32( a, b );
+  else
+  {
+    // SSE2 has no 64-bit compare; both 32-bit halves must match
+    eq = _mm_cmpeq_epi32( a, b );
+    eq = _mm_and_si128( eq, _mm_shuffle_epi32( eq, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+  }
+  return static_cast<uint32_t>( _mm_movemask_epi8( eq ) );
+}
+
+#elif defined(PK_SIMD_NEON)
+
+using SimdVec = uint8x16_t;
+constexpr size_t SimdBytes = 16;
+
+template <typename T>
+constexpr size_t SimdBitsPerLane = sizeof( T ) * 4; // a nibble per byte; see below
+
+inline SimdVec SimdLoad( const void* p ) noexcept
+{
+  return vld1q_u8( static_cast<const uint8_t*>( p ) );
+}
+
+template <typename T>
+uint64_t SimdEqualMask( SimdVec a, SimdVec b ) noexcept
+{
+  SimdVec eq;
+  if constexpr( std::is_same_v<T, float> )
+    eq = vreinterpretq_u8_u32( vceqq_f32( vreinterpretq_f32_u8( a ), vreinterpretq_f32_u8( b ) ) );
+#if defined(__aarch64__) || defined(_M_ARM64)
+  else if constexpr( std::is_same_v<T, double> )
+    eq = vreinterpretq_u8_u64( vceqq_f64( vreinterpretq_f64_u8( a ), vreinterpretq_f64_u8( b ) ) );
+  else if constexpr( sizeof( T ) == 8 )
+    eq = vreinterpretq_u8_u64( vceqq_u64( vreinterpretq_u64_u8( a ), vreinterpretq_u64_u8( b ) ) );
+#else
+  else if constexpr( sizeof( T ) == 8 )
+  {
+    // 32-bit NEON has no 64-bit compare; both 32-bit halves must match
+    const auto eq32 = vceqq_u32( vreinterpretq_u32_u8( a ), vreinterpretq_u32_u8( b ) );
+    eq = vreinterpretq_u8_u32( vandq_u32( eq32, vrev64q_u32( eq32 ) ) );
+  }
+#endif
+  else if constexpr( sizeof( T ) == 4 )
+    eq = vreinterpretq_u8_u32( vceqq_u32( vreinterpretq_u32_u8( a ), vreinterpretq_u32_u8( b ) ) );
+  else if constexpr( sizeof( T ) == 2 )
+    eq = vreinterpretq_u8_u16( vceqq_u16( vreinterpretq_u16_u8( a ), vreinterpretq_u16_u8( b ) ) );
+  else
+    eq = vceqq_u8( a, b );
+  // NEON has no movemask; narrowing each 16-bit pair by 4 leaves a nibble per byte
+  return vget_lane_u64( vreinterpret_u64_u8( vshrn_n_u16( vreinterpretq_u16_u8( eq ), 4 ) ), 0 );
+}
+
+#endif
+
+// Elements the vector kernels support
+template <typename T>
+concept SimdElement =
+#if defined(PK_SIMD)
+  ( std::is_integral_v<T> && sizeof( T ) <= 8 ) || std::is_same_v<T, float> ||
+#if defined(PK_SIMD_NEON) && !defined(__aarch64__) && !defined(_M_ARM64)
+  false; // 32-bit NEON can't compare doubles
+#else
+  std::is_same_v<T, double>;
+#endif
+#else
+  false;
+#endif
+
+#if defined(PK_SIMD)
+
+template <typename T>
+constexpr size_t SimdLanes = SimdBytes / sizeof( T );
+
+// Vectors examined per loop iteration; one branch covers them all
+constexpr size_t SimdUnroll = 4;
+
+// Mask bits for every element of a vector
+template <typename T>
+constexpr uint64_t SimdAllLanes = ( SimdLanes<T> * SimdBitsPerLane<T> == 64 ) ? ~uint64_t( 0 ) :
+                                  ( uint64_t( 1 ) << ( SimdLanes<T> * SimdBitsPerLane<T> ) ) - 1;
+
+template <typename T>
+SimdVec SimdSplat( const T& v ) noexcept
+{
+  T lanes[ SimdLanes<T> ];
+  std::fill_n( lanes, SimdLanes<T>, v );
+  return SimdLoad( lanes );
+}
+
+template <typename T>
+size_t SimdFirstLane( uint64_t mask ) noexcept
+{
+  return static_cast<size_t>( std::countr_zero( mask ) ) / SimdBitsPerLane<T>;
+}
+
+template <typename T>
+size_t SimdLastLane( uint64_t mask ) noexcept
+{
+  return static_cast<size_t>( 63 - std::countl_zero( mask ) ) / SimdBitsPerLane<T>;
+}
+
+#endif
+
+// Index of the first element equal to v, or count if there is none
+template <typename T>
+constexpr size_t FindFirst( const T* p, size_t count, const T& v ) noexcept
+{
+  size_t i = 0;
+#if defined(PK_SIMD)
+  if constexpr( SimdElement<T> )
+  {
+    if( !std::is_constant_evaluated() )
+    {
+      constexpr auto lanes = SimdLanes<T>;
+      const auto needle = SimdSplat( v );
+      for( ; i + lanes * SimdUnroll <= count; i += lanes * SimdUnroll )
+      {
+        uint64_t matches[ SimdUnroll ];
+        uint64_t any = 0;
+        for( size_t n = 0; n < SimdUnroll; ++n )
+        {
+          matches[n] = SimdEqualMask<T>( SimdLoad( p + i + n * lanes ), needle );
+          any |= matches[n];
+        }
+        if( any )
+          for( size_t n = 0; ; ++n )
+            if( matches[n] )
+              return i + n * lanes + SimdFirstLane<T>( matches[n] );
+      }
+      for( ; i + lanes <= count; i += lanes )
+        if( const auto matches = SimdEqualMask<T>( SimdLoad( p + i ), needle ) )
+          return i + SimdFirstLane<T>( matches );
+    }
+  }
+#endif
+  for( ; i < count; ++i )
+    if( p[i] == v )
+      return i;
+  return count;
+}
+
+// Index of the last element equal to v, or count if there is none
+template <typename T>
+constexpr size_t FindLast( const T* p, size_t count, const T& v ) noexcept
+{
+  size_t i = count; // elements below i remain to be searched
+#if defined(PK_SIMD)
+  if constexpr( SimdElement<T> )
+  {
+    if( !std::is_constant_evaluated() )
+    {
+      constexpr auto lanes = SimdLanes<T>;
+      const auto needle = SimdSplat( v );
+      for( ; i >= lanes * SimdUnroll; i -= lanes * SimdUnroll )
+      {
+        const auto block = i - lanes * SimdUnroll;
+        uint64_t matches[ SimdUnroll ];
+        uint64_t any = 0;
+        for( size_t n = 0; n < SimdUnroll; ++n )
+        {
+          matches[n] = SimdEqualMask<T>( SimdLoad( p + block + n * lanes ), needle );
+          any |= matches[n];
+        }
+        if( any )
+          for( size_t n = SimdUnroll - 1; ; --n )
+            if( matches[n] )
+              return block + n * lanes + SimdLastLane<T>( matches[n] );
+      }
+      for( ; i >= lanes; i -= lanes )
+        if( const auto matches = SimdEqualMask<T>( SimdLoad( p + i - lanes ), needle ) )
+          return i - lanes + SimdLastLane<T>( matches );
+    }
+  }
+#endif
+  while( i > 0 )
+    if( p[--i] == v )
+      return i;
+  return count;
+}
+
+// Index of the first position where lhs and rhs differ, or count if they don't
+template <typename T>
+constexpr size_t Mismatch( const T* lhs, const T* rhs, size_t count ) noexcept
+{
+  size_t i = 0;
+#if defined(PK_SIMD)
+  if constexpr( SimdElement<T> )
+  {
+    if( !std::is_constant_evaluated() )
+    {
+      constexpr auto lanes = SimdLanes<T>;
+      for( ; i + lanes * SimdUnroll <= count; i += lanes * SimdUnroll )
+      {
+        uint64_t mismatches[ SimdUnroll ];
+        uint64_t any = 0;
+        for( size_t n = 0; n < SimdUnroll; ++n )
+        {
+          const auto offset = i + n * lanes;
+          mismatches[n] = ~SimdEqualMask<T>( SimdLoad( lhs + offset ), SimdLoad( rhs + offset ) ) &
+                          SimdAllLanes<T>;
+          any |= mismatches[n];
+        }
+        if( any )
+          for( size_t n = 0; ; ++n )
+            if( mismatches[n] )
+              return i + n * lanes + SimdFirstLane<T>( mismatches[n] );
+      }
+      for( ; i + lanes <= count; i += lanes )
+        if( const auto mismatches = ~SimdEqualMask<T>( SimdLoad( lhs + i ), SimdLoad( rhs + i ) ) &
+                                    SimdAllLanes<T> )
+          return i + SimdFirstLane<T>( mismatches );
+    }
+  }
+#endif
+  for( ; i < count; ++i )
+    if( !( lhs[i] == rhs[i] ) )
+      return i;
+  return count;
+}
+
+}; // namespace anonymous
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_snapshot.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  Snapshots of array_stacks of trivially copyable objects: a fixed-size versioned
+//  header followed by the live elements exactly as they are in memory.
+//
+//    std::vector<std::byte> buffer( snapshot_size( frames ) );
+//    write_snapshot( frames, buffer );   // one memcpy for the elements
+//    ...
+//    if( !read_snapshot( frames, buffer ) ) ... // one memcpy back
+//
+//  The header records sizeof(T), alignof(T), Capacity, the element count and the
+//  byte order, and a snapshot is only read into a stack whose elements match it.
+//  Elements start at an offset of 32 bytes, so a snapshot file mapped into memory
+//  can also be used in place through snapshot_elements(), without any copy.
+//
+//  Snapshots hold bytes, not values: only objects whose bytes are their value
+//  (no pointers into the process, for instance) survive being restored elsewhere.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <optional>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+struct array_stack_snapshot_header
+{
+  static constexpr uint32_t signature = 0x4B545341; // "ASTK" when stored little-endian
+  static constexpr uint16_t current_version = 1;
+
+  uint32_t magic = signature;
+  uint16_t version = current_version;
+  uint8_t  little_endian = ( std::endian::native == std::endian::little );
+  uint8_t  reserved = 0;
+  uint32_t element_size = 0;
+  uint32_t element_alignment = 0;
+  uint64_t capacity = 0;
+  uint64_t size = 0;     // number of elements that follow the header
+};
+
+static_assert( sizeof( array_stack_snapshot_header ) == 32 &&
+               std::is_trivially_copyable_v<array_stack_snapshot_header> );
+
+template <typename T, size_t Capacity>
+constexpr array_stack_snapshot_header make_snapshot_header( size_t size ) noexcept
+{
+  array_stack_snapshot_header header;
+  header.element_size = sizeof( T );
+  header.element_alignment = alignof( T );
+  header.capacity = Capacity;
+  header.size = size;
+  return header;
+}
+
+// Bytes needed to snapshot s
+template <typename T, size_t Capacity, typename Traits>
+constexpr size_t snapshot_size( const array_stack<T, Capacity, Traits>& s ) noexcept
+{
+  return sizeof( array_stack_snapshot_header ) + s.size() * sizeof( T );
+}
+
+// Writes a snapshot of s to the start of out; returns the number of bytes written, or 0
+// if out is smaller than snapshot_size( s )
+template <typename T, size_t Capacity, typename Traits>
+size_t write_snapshot( const array_stack<T, Capacity, Traits>& s, std::span<std::byte> out ) noexcept
+{
+  const auto bytes = s.as_bytes();
+  if( out.size() < sizeof( array_stack_snapshot_header ) + bytes.size() )
+    return 0;
+  const auto header = make_snapshot_header<T, Capacity>( s.size() );
+  std::memcpy( out.data(), &header, sizeof( header ) );
+  if( !bytes.empty() )
+    std::memcpy( out.data() + sizeof( header ), bytes.data(), bytes.size() );
+  return sizeof( header ) + bytes.size();
+}
+
+// The header of the snapshot at the start of bytes if it holds elements T laid out as
+// on this machine, all present in bytes, and at most Capacity of them
+template <typename T, size_t Capacity>
+std::optional<array_stack_snapshot_header> read_snapshot_header( std::span<const std::byte> bytes ) noexcept
+{
+  array_stack_snapshot_header header;
+  if( bytes.size() < sizeof( header ) )
+    return std::nullopt;
+  std::memcpy( &header, bytes.data(), sizeof( header ) );
+  const auto expected = make_snapshot_header<T, Capacity>( 0 );
+  if( header.magic != expected.magic || header.version != expected.version ||
+      header.little_endian != expected.little_endian ||
+      header.element_size != expected.element_size ||
+      header.element_alignment != expected.element_alignment ||
+      header.size > Capacity ||
+      header.size > ( bytes.size() - sizeof( header ) ) / sizeof( T ) )
+    return std::nullopt;
+  return header;
+}
+
+// Replaces the contents of s with the snapshot at the start of bytes; returns false,
+// leaving s unchanged, if the snapshot isn't valid for s. The snapshot may have been
+// taken from a stack of a different Capacity, if its elements fit.
+template <typename T, size_t Capacity, typename Traits>
+bool read_snapshot( array_stack<T, Capacity, Traits>& s, std::span<const std::byte> bytes ) noexcept
+{
+  const auto header = read_snapshot_header<T, Capacity>( bytes );
+  if( !header )
+    return false;
+  return s.from_bytes( bytes.subspan( sizeof( array_stack_snapshot_header ),
+                                      static_cast<size_t>( header->size ) * sizeof( T ) ) );
+}
+
+// The elements of the snapshot at the start of bytes, in place, e.g. in a mapped file.
+// Empty if the snapshot isn't valid for a stack of T of at most Capacity elements, or
+// bytes isn't suitably aligned for T.
+template <typename T, size_t Capacity>
+std::span<const T> snapshot_elements( std::span<const std::byte> bytes ) noexcept
+{
+  static_assert( std::is_trivially_copyable_v<T>, "snapshots require trivially copyable T" );
+  const auto header = read_snapshot_header<T, Capacity>( bytes );
+  if( !header )
+    return {};
+  const auto elements = bytes.data() + sizeof( array_stack_snapshot_header );
+  if( reinterpret_cast<uintptr_t>( elements ) % alignof( T ) != 0 )
+    return {};
+  return { reinterpret_cast<const T*>( elements ), static_cast<size_t>( header->size ) };
+}
+
+} // namespace PKIsensee
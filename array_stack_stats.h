@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_stats.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  Statistics policies for array_stack, to choose Capacity from how deep stacks
+//  really get rather than by guesswork.
+//
+//  The policy is array_stack_traits::stats_type. The default, no_stats, is empty
+//  and compiles away. array_stack_stats counts pushes, pops, overflow attempts and
+//  near-full events and records the high-water mark of each stack:
+//
+//    counted_array_stack<Token, 256> tokens;
+//    ...
+//    log( tokens.stats().high_water_mark() );
+//
+//  registered_array_stack_stats also adds its counts to array_stack_registry when
+//  the stack is destroyed (or on publish()), keyed by ( typeid(T), Capacity, Tag ),
+//  so the depths reached by every stack of a kind can be exported in one place:
+//
+//    registered_array_stack<Token, 256, struct ParserTag> tokens;
+//    ...
+//    for( const auto& [key, counters] : array_stack_registry::instance().snapshot() ) ...
+//
+//  Counting is not synchronized, like array_stack itself; the registry is.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <map>
+#include <mutex>
+#include <typeindex>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+// Counts recorded by array_stack_stats
+struct array_stack_counters
+{
+  size_t high_water_mark = 0; // largest size reached
+  size_t push_count = 0;      // elements pushed
+  size_t pop_count = 0;       // elements popped; clear() isn't counted
+  size_t near_full_count = 0; // pushes that reached the near-full threshold from below it
+  size_t overflow_count = 0;  // pushes that didn't fit, whatever the overflow policy
+
+  // Combine the counts of another stack
+  constexpr void merge( const array_stack_counters& rhs ) noexcept
+  {
+    high_water_mark = std::max( high_water_mark, rhs.high_water_mark );
+    push_count += rhs.push_count;
+    pop_count += rhs.pop_count;
+    near_full_count += rhs.near_full_count;
+    overflow_count += rhs.overflow_count;
+  }
+
+  constexpr bool operator==( const array_stack_counters& ) const noexcept = default;
+};
+
+// Per-instance statistics; a stack is near full at NearFullPercent of its Capacity
+template <unsigned NearFullPercent = 90>
+class array_stack_stats
+{
+  static_assert( NearFullPercent > 0 && NearFullPercent <= 100,
+                 "NearFullPercent must be in ( 0, 100 ]" );
+
+public:
+
+  constexpr void on_push( size_t count, size_t size, size_t capacity ) noexcept
+  {
+    counters_.push_count += count;
+    counters_.high_water_mark = std::max( counters_.high_water_mark, size );
+    const auto nearFull = NearFullSize( capacity );
+    if( size >= nearFull && ( size - count ) < nearFull )
+      ++counters_.near_full_count;
+  }
+
+  constexpr void on_pop( size_t count ) noexcept
+  {
+    counters_.pop_count += count;
+  }
+
+  constexpr void on_overflow() noexcept
+  {
+    ++counters_.overflow_count;
+  }
+
+  constexpr size_t high_water_mark() const noexcept
+  {
+    return counters_.high_water_mark;
+  }
+
+  constexpr size_t push_count() const noexcept
+  {
+    return counters_.push_count;
+  }
+
+  constexpr size_t pop_count() const noexcept
+  {
+    return counters_.pop_count;
+  }
+
+  constexpr size_t near_full_count() const noexcept
+  {
+    return counters_.near_full_count;
+  }
+
+  constexpr size_t overflow_count() const noexcept
+  {
+    return counters_.overflow_count;
+  }
+
+  constexpr const array_stack_counters& counters() const noexcept
+  {
+    return counters_;
+  }
+
+  constexpr void reset() noexcept
+  {
+    counters_ = {};
+  }
+
+private:
+
+  // Smallest size at or above NearFullPercent of capacity
+  static constexpr size_t NearFullSize( size_t capacity ) noexcept
+  {
+    return std::max<size_t>( 1, ( capacity * NearFullPercent + 99 ) / 100 );
+  }
+
+private:
+
+  array_stack_counters counters_;
+
+}; // class array_stack_stats
+
+// Process-wide totals of the statistics published by registered stacks
+class array_stack_registry
+{
+public:
+
+  struct key
+  {
+    std::type_index type;     // typeid(T)
+    size_t capacity;
+    std::type_index tag;      // typeid(std::type_identity<Tag>), so Tag can be incomplete
+
+    auto operator<=>( const key& ) const noexcept = default;
+  };
+
+  using snapshot_type = std::map<key, array_stack_counters>;
+
+  static array_stack_registry& instance()
+  {
+    static array_stack_registry registry;
+    return registry;
+  }
+
+  array_stack_registry( const array_stack_registry& ) = delete;
+  array_stack_registry& operator=( const array_stack_registry& ) = delete;
+
+  void publish( const key& k, const array_stack_counters& counters )
+  {
+    std::scoped_lock lock( mutex_ );
+    totals_[k].merge( counters );
+  }
+
+  // Totals so far, one entry per key
+  snapshot_type snapshot() const
+  {
+    std::scoped_lock lock( mutex_ );
+    return totals_;
+  }
+
+  void reset()
+  {
+    std::scoped_lock lock( mutex_ );
+    totals_.clear();
+  }
+
+private:
+
+  array_stack_registry() = default;
+
+private:
+
+  mutable std::mutex mutex_;
+  snapshot_type totals_;
+
+}; // class array_stack_registry
+
+// array_stack_stats that publish to array_stack_registry when the stack is destroyed
+template <typename T, size_t Capacity, typename Tag = void, unsigned NearFullPercent = 90>
+class registered_array_stack_stats : public array_stack_stats<NearFullPercent>
+{
+public:
+
+  registered_array_stack_stats()
+  {
+    // Construct the registry first so that it outlives static stacks
+    array_stack_registry::instance();
+  }
+
+  registered_array_stack_stats( const registered_array_stack_stats& ) = delete;
+  registered_array_stack_stats& operator=( const registered_array_stack_stats& ) = delete;
+
+  ~registered_array_stack_stats()
+  {
+    publish();
+  }
+
+  // Add the counts so far to the registry, then reset them; useful for long-lived stacks
+  void publish()
+  {
+    array_stack_registry::instance().publish( registry_key(), this->counters() );
+    this->reset();
+  }
+
+  static array_stack_registry::key registry_key() noexcept
+  {
+    return { typeid( T ), Capacity, typeid( std::type_identity<Tag> ) }; // Tag may be incomplete
+  }
+
+}; // class registered_array_stack_stats
+
+template <typename T, size_t Capacity>
+struct counted_array_stack_traits : array_stack_traits<T, Capacity>
+{
+  using stats_type = array_stack_stats<>;
+};
+
+template <typename T, size_t Capacity, typename Tag = void>
+struct registered_array_stack_traits : array_stack_traits<T, Capacity>
+{
+  using stats_type = registered_array_stack_stats<T, Capacity, Tag>;
+};
+
+template <typename T, size_t Capacity>
+using counted_array_stack = array_stack<T, Capacity, counted_array_stack_traits<T, Capacity>>;
+
+template <typename T, size_t Capacity, typename Tag = void>
+using registered_array_stack = array_stack<T, Capacity, registered_array_stack_traits<T, Capacity, Tag>>;
+
+} // namespace PKIsensee
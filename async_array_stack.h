@@ -0,0 +1,326 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  async_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  async_array_stack<T, Capacity, Mutex> is an array_stack for passing objects T
+//  between coroutines. Pushing suspends the producer while the stack is full and
+//  popping suspends the consumer while it is empty, giving backpressure:
+//
+//    async_array_stack<Job, 64> jobs;
+//    co_await jobs.push_async( job );    // producer
+//    Job job = co_await jobs.pop_async(); // consumer
+//
+//  Each waiting coroutine is linked into a list through its awaiter, which lives in
+//  the coroutine frame, so waiting allocates nothing. Waiters are woken in the order
+//  they arrived, and are resumed on the thread that made room for them (or pushed an
+//  element for them), before its own push or pop returns. A waiting coroutine must
+//  not be destroyed.
+//
+//  The default Mutex, no_lock, is for coroutines that all run on one thread, e.g.
+//  under a single-threaded executor. concurrent_async_array_stack uses std::mutex,
+//  for coroutines running on any thread.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <coroutine>
+#include <mutex>
+#include <optional>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+// Mutex for objects used from a single thread; locking does nothing
+struct no_lock
+{
+  constexpr void lock() noexcept {}
+  constexpr void unlock() noexcept {}
+};
+
+template <typename T, size_t Capacity, // stack of objects T; maximum size Capacity
+          typename Mutex = no_lock>    // guards the stack and its waiters
+class async_array_stack
+{
+  // Intrusive FIFO of suspended awaiters, linked through their next_ members
+  template <typename Awaiter>
+  class Waiters
+  {
+  public:
+
+    bool empty() const noexcept
+    {
+      return head_ == nullptr;
+    }
+
+    void push_back( Awaiter* a ) noexcept
+    {
+      a->next_ = nullptr;
+      ( tail_ == nullptr ? head_ : tail_->next_ ) = a;
+      tail_ = a;
+    }
+
+    Awaiter* pop_front() noexcept
+    {
+      auto a = head_;
+      if( a != nullptr )
+      {
+        head_ = a->next_;
+        if( head_ == nullptr )
+          tail_ = nullptr;
+      }
+      return a;
+    }
+
+  private:
+
+    Awaiter* head_ = nullptr;
+    Awaiter* tail_ = nullptr;
+  };
+
+public:
+
+  using value_type              = T;
+  using size_type               = size_t;
+  using mutex_type              = Mutex;
+
+  // Result of push_async(); completes once v is on the stack or handed to a waiting consumer
+  class push_awaiter
+  {
+  public:
+
+    push_awaiter( const push_awaiter& ) = delete;
+    push_awaiter& operator=( const push_awaiter& ) = delete;
+
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    // Returns true, suspending, only if the stack is full
+    bool await_suspend( std::coroutine_handle<> h )
+    {
+      handle_ = h;
+      std::coroutine_handle<> wake;
+      {
+        std::scoped_lock lock( stack_.mutex_ );
+        if( !stack_.PushLocked( value_, wake ) )
+        {
+          // Once the lock is released, this awaiter may be resumed and destroyed at any time
+          stack_.pushers_.push_back( this );
+          return true;
+        }
+      }
+      if( wake )
+        wake.resume();
+      return false;
+    }
+
+    constexpr void await_resume() const noexcept
+    {
+    }
+
+  private:
+
+    friend class async_array_stack;
+    friend class Waiters<push_awaiter>;
+
+    push_awaiter( async_array_stack& s, T&& v ) :
+      stack_( s ),
+      value_( std::move( v ) )
+    {
+    }
+
+    async_array_stack& stack_;
+    T value_;
+    push_awaiter* next_ = nullptr;
+    std::coroutine_handle<> handle_;
+  };
+
+  // Result of pop_async(); completes with the top element once the stack isn't empty
+  class pop_awaiter
+  {
+  public:
+
+    pop_awaiter( const pop_awaiter& ) = delete;
+    pop_awaiter& operator=( const pop_awaiter& ) = delete;
+
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    // Returns true, suspending, only if the stack is empty
+    bool await_suspend( std::coroutine_handle<> h )
+    {
+      handle_ = h;
+      std::coroutine_handle<> wake;
+      {
+        std::scoped_lock lock( stack_.mutex_ );
+        if( !stack_.PopLocked( result_, wake ) )
+        {
+          stack_.poppers_.push_back( this );
+          return true;
+        }
+      }
+      if( wake )
+        wake.resume();
+      return false;
+    }
+
+    T await_resume()
+    {
+      return std::move( *result_ );
+    }
+
+  private:
+
+    friend class async_array_stack;
+    friend class Waiters<pop_awaiter>;
+
+    explicit pop_awaiter( async_array_stack& s ) noexcept :
+      stack_( s )
+    {
+    }
+
+    async_array_stack& stack_;
+    std::optional<T> result_;
+    pop_awaiter* next_ = nullptr;
+    std::coroutine_handle<> handle_;
+  };
+
+  async_array_stack() = default;
+
+  async_array_stack( const async_array_stack& ) = delete;
+  async_array_stack& operator=( const async_array_stack& ) = delete;
+
+  // No coroutine may still be waiting
+  ~async_array_stack()
+  {
+    PK_ASSERT( pushers_.empty() && poppers_.empty() );
+  }
+
+  [[nodiscard]] push_awaiter push_async( value_type v )
+  {
+    return push_awaiter( *this, std::move( v ) );
+  }
+
+  [[nodiscard]] pop_awaiter pop_async() noexcept
+  {
+    return pop_awaiter( *this );
+  }
+
+  // Non-suspending alternatives, which also wake waiters. try_push() returns false if
+  // the stack is full; try_pop() returns nothing if the stack is empty.
+  bool try_push( value_type v )
+  {
+    std::coroutine_handle<> wake;
+    {
+      std::scoped_lock lock( mutex_ );
+      if( !PushLocked( v, wake ) )
+        return false;
+    }
+    if( wake )
+      wake.resume();
+    return true;
+  }
+
+  std::optional<value_type> try_pop()
+  {
+    std::optional<value_type> result;
+    std::coroutine_handle<> wake;
+    {
+      std::scoped_lock lock( mutex_ );
+      if( !PopLocked( result, wake ) )
+        return result;
+    }
+    if( wake )
+      wake.resume();
+    return result;
+  }
+
+  // With a real Mutex these are snapshots; other threads may change the result
+  // before it is examined
+
+  bool empty() const
+  {
+    std::scoped_lock lock( mutex_ );
+    return s_.empty();
+  }
+
+  bool full() const
+  {
+    std::scoped_lock lock( mutex_ );
+    return s_.full();
+  }
+
+  size_type size() const
+  {
+    std::scoped_lock lock( mutex_ );
+    return s_.size();
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+private:
+
+  // With the lock held, pushes v or hands it to the longest-waiting consumer, which is
+  // returned in wake to be resumed once the lock is released. Returns false if full.
+  bool PushLocked( T& v, std::coroutine_handle<>& wake )
+  {
+    if( auto popper = poppers_.pop_front() ) // consumers only wait on an empty stack
+    {
+      popper->result_.emplace( std::move( v ) );
+      wake = popper->handle_;
+      return true;
+    }
+    if( s_.full() )
+      return false;
+    s_.push( std::move( v ) );
+    return true;
+  }
+
+  // With the lock held, pops the top element into result and, now that there is room,
+  // pushes the element of the longest-waiting producer, which is returned in wake.
+  // Returns false if empty.
+  bool PopLocked( std::optional<T>& result, std::coroutine_handle<>& wake )
+  {
+    if( s_.empty() )
+      return false;
+    result.emplace( s_.top_and_pop() );
+    if( auto pusher = pushers_.pop_front() ) // producers only wait on a full stack
+    {
+      s_.push( std::move( pusher->value_ ) );
+      wake = pusher->handle_;
+    }
+    return true;
+  }
+
+private:
+
+  array_stack<T, Capacity> s_;
+  Waiters<push_awaiter> pushers_; // waiting for room
+  Waiters<pop_awaiter> poppers_;  // waiting for an element
+  PK_NO_UNIQUE_ADDRESS mutable Mutex mutex_;
+
+}; // class async_array_stack
+
+template <typename T, size_t Capacity>
+using concurrent_async_array_stack = async_array_stack<T, Capacity, std::mutex>;
+
+} // namespace PKIsensee
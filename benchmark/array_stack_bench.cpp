@@ -0,0 +1,384 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_bench.cpp
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  Google Benchmark suite comparing array_stack against std::stack over
+//  std::vector and std::deque, std::inplace_vector where the standard library
+//  provides it, and boost::container::static_vector when Boost is available.
+//
+//  Every operation is measured for a trivially copyable (uint64_t) and a
+//  non-trivial (std::string) element at Capacity 16, 256, 4096 and 65536.
+//  Containers are heap allocated so that large Capacities don't overflow the
+//  benchmark thread's stack.
+//
+//  Besides items per second, each benchmark reports cycles/op from the time stamp
+//  counter where there is one (x86). The TSC ticks at a constant rate, so this is
+//  reference cycles; for core cycles and instructions, run with Google Benchmark's
+//  perf counters (built with libpfm): --benchmark_perf_counters=CYCLES,INSTRUCTIONS
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <stack>
+#include <string>
+#include <vector>
+#include <version>
+
+#if defined(__cpp_lib_inplace_vector)
+  #include <inplace_vector>
+#endif
+
+#if defined(PK_BENCH_BOOST_STATIC_VECTOR)
+  #include <boost/container/static_vector.hpp>
+#endif
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+  #include <intrin.h>
+  #define PK_BENCH_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define PK_BENCH_TSC 1
+#endif
+
+#include <benchmark/benchmark.h>
+#include "array_stack.h"
+
+namespace // anonymous
+{
+
+template <typename T, size_t Capacity>
+using ArrayStack = PKIsensee::array_stack<T, Capacity>;
+
+template <typename T, size_t>
+using VectorStack = std::stack<T, std::vector<T>>;
+
+template <typename T, size_t>
+using DequeStack = std::stack<T, std::deque<T>>;
+
+#if defined(__cpp_lib_inplace_vector)
+template <typename T, size_t Capacity>
+using InplaceVector = std::inplace_vector<T, Capacity>;
+#endif
+
+#if defined(PK_BENCH_BOOST_STATIC_VECTOR)
+template <typename T, size_t Capacity>
+using StaticVector = boost::container::static_vector<T, Capacity>;
+#endif
+
+// Values are distinct; strings are long enough to defeat the small string optimization
+template <typename T>
+T MakeValue( size_t i )
+{
+  if constexpr( std::is_same_v<T, std::string> )
+    return std::string( 32, 'a' + static_cast<char>( i % 26 ) );
+  else
+    return static_cast<T>( i );
+}
+
+template <typename T>
+std::vector<T> MakeValues( size_t count )
+{
+  std::vector<T> values;
+  values.reserve( count );
+  for( size_t i = 0; i < count; ++i )
+    values.push_back( MakeValue<T>( i ) );
+  return values;
+}
+
+// std::stack hides its container; this exposes it for iteration
+template <typename Stack>
+struct StackAccess : Stack
+{
+  static const auto& Container( const Stack& s )
+  {
+    return s.*&StackAccess::c;
+  }
+};
+
+// Uniform operations over stacks and vector-like baselines
+
+template <typename C, typename T>
+void Push( C& c, T&& v )
+{
+  if constexpr( requires { c.push( std::forward<T>( v ) ); } )
+    c.push( std::forward<T>( v ) );
+  else
+    c.push_back( std::forward<T>( v ) );
+}
+
+template <typename C>
+void Pop( C& c )
+{
+  if constexpr( requires { c.pop(); } )
+    c.pop();
+  else
+    c.pop_back();
+}
+
+template <typename C>
+const auto& Top( const C& c )
+{
+  if constexpr( requires { c.top(); } )
+    return c.top();
+  else
+    return c.back();
+}
+
+template <typename C, typename Range>
+void PushRange( C& c, const Range& rng )
+{
+  if constexpr( requires { c.push_range( rng ); } )
+    c.push_range( rng );
+  else if constexpr( requires { c.append_range( rng ); } )
+    c.append_range( rng );
+  else if constexpr( requires { c.insert( c.end(), rng.begin(), rng.end() ); } )
+    c.insert( c.end(), rng.begin(), rng.end() );
+  else
+    for( const auto& v : rng )
+      c.push( v );
+}
+
+template <typename C>
+void Clear( C& c )
+{
+  if constexpr( requires { c.clear(); } )
+    c.clear();
+  else
+    c = C{};
+}
+
+template <typename C>
+const auto& Elements( const C& c )
+{
+  if constexpr( requires { c.begin(); } )
+    return c;
+  else
+    return StackAccess<C>::Container( c );
+}
+
+template <typename C>
+auto Compare( const C& lhs, const C& rhs )
+{
+  if constexpr( std::three_way_comparable<C> )
+    return lhs <=> rhs;
+  else
+    return lhs < rhs;
+}
+
+template <typename C, typename T>
+bool Contains( const C& c, const T& v )
+{
+  if constexpr( requires { c.contains( v ); } )
+    return c.contains( v );
+  else
+  {
+    const auto& elements = Elements( c );
+    return std::find( elements.begin(), elements.end(), v ) != elements.end();
+  }
+}
+
+template <typename C, typename T>
+std::unique_ptr<C> MakeFilled( size_t count )
+{
+  auto c = std::make_unique<C>();
+  for( size_t i = 0; i < count; ++i )
+    Push( *c, MakeValue<T>( i ) );
+  return c;
+}
+
+// Time stamp counter, or 0 where there isn't one
+uint64_t ReadCycles() noexcept
+{
+#if defined(PK_BENCH_TSC)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Records itemsPerIteration items for every iteration of state, and the cycles per item
+// since start, the ReadCycles() value before the benchmark loop
+void SetItemsProcessed( benchmark::State& state, uint64_t start, size_t itemsPerIteration )
+{
+  const auto cycles = ReadCycles() - start;
+  const auto items = static_cast<int64_t>( state.iterations() ) * static_cast<int64_t>( itemsPerIteration );
+  state.SetItemsProcessed( items );
+#if defined(PK_BENCH_TSC)
+  if( items > 0 )
+    state.counters["cycles/op"] = static_cast<double>( cycles ) / static_cast<double>( items );
+#else
+  (void)cycles;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+// Fill to Capacity, then drain
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_PushPop( benchmark::State& state )
+{
+  auto c = std::make_unique<Container<T, Capacity>>();
+  const auto values = MakeValues<T>( Capacity );
+  const auto start = ReadCycles();
+  for( auto _ : state )
+  {
+    for( const auto& v : values )
+      Push( *c, v );
+    while( !c->empty() )
+    {
+      benchmark::DoNotOptimize( Top( *c ) );
+      Pop( *c );
+    }
+  }
+  SetItemsProcessed( state, start, Capacity * 2 );
+}
+
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_PushRange( benchmark::State& state )
+{
+  auto c = std::make_unique<Container<T, Capacity>>();
+  const auto values = MakeValues<T>( Capacity );
+  const auto start = ReadCycles();
+  for( auto _ : state )
+  {
+    PushRange( *c, values );
+    benchmark::ClobberMemory();
+    Clear( *c );
+  }
+  SetItemsProcessed( state, start, Capacity );
+}
+
+// Copy of a half-full container; copying mostly-empty stacks is the common case
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_Copy( benchmark::State& state )
+{
+  using C = Container<T, Capacity>;
+  const auto src = MakeFilled<C, T>( Capacity / 2 );
+  auto dest = std::make_unique<C>();
+  const auto start = ReadCycles();
+  for( auto _ : state )
+  {
+    *dest = *src;
+    benchmark::ClobberMemory();
+  }
+  SetItemsProcessed( state, start, Capacity / 2 );
+}
+
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_Swap( benchmark::State& state )
+{
+  using C = Container<T, Capacity>;
+  auto lhs = MakeFilled<C, T>( Capacity / 2 );
+  auto rhs = MakeFilled<C, T>( Capacity / 4 );
+  const auto start = ReadCycles();
+  for( auto _ : state )
+  {
+    lhs->swap( *rhs );
+    benchmark::ClobberMemory();
+  }
+  SetItemsProcessed( state, start, 1 );
+}
+
+// Equal contents, so every element is visited
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_Compare( benchmark::State& state )
+{
+  using C = Container<T, Capacity>;
+  const auto lhs = MakeFilled<C, T>( Capacity / 2 );
+  const auto rhs = MakeFilled<C, T>( Capacity / 2 );
+  const auto start = ReadCycles();
+  for( auto _ : state )
+    benchmark::DoNotOptimize( Compare( *lhs, *rhs ) );
+  SetItemsProcessed( state, start, Capacity / 2 );
+}
+
+// Search for a value that isn't present, so every element is visited
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_Contains( benchmark::State& state )
+{
+  using C = Container<T, Capacity>;
+  const auto c = MakeFilled<C, T>( Capacity );
+  const auto missing = MakeValue<T>( Capacity + 1 );
+  const auto start = ReadCycles();
+  for( auto _ : state )
+    benchmark::DoNotOptimize( Contains( *c, missing ) );
+  SetItemsProcessed( state, start, Capacity );
+}
+
+template <template <typename, size_t> typename Container, typename T, size_t Capacity>
+void BM_Iterate( benchmark::State& state )
+{
+  using C = Container<T, Capacity>;
+  const auto c = MakeFilled<C, T>( Capacity );
+  const auto start = ReadCycles();
+  for( auto _ : state )
+  {
+    size_t sum = 0;
+    for( const auto& v : Elements( *c ) )
+    {
+      if constexpr( std::is_same_v<T, std::string> )
+        sum += v.size();
+      else
+        sum += static_cast<size_t>( v );
+    }
+    benchmark::DoNotOptimize( sum );
+  }
+  SetItemsProcessed( state, start, Capacity );
+}
+
+} // namespace anonymous
+
+///////////////////////////////////////////////////////////////////////////////
+// Registration: every benchmark x container x element type x Capacity
+
+#define PK_BENCH_CAPACITIES( BM, Container, T ) \
+  BENCHMARK_TEMPLATE( BM, Container, T, 16 );   \
+  BENCHMARK_TEMPLATE( BM, Container, T, 256 );  \
+  BENCHMARK_TEMPLATE( BM, Container, T, 4096 ); \
+  BENCHMARK_TEMPLATE( BM, Container, T, 65536 )
+
+#define PK_BENCH_TYPES( BM, Container )            \
+  PK_BENCH_CAPACITIES( BM, Container, uint64_t );  \
+  PK_BENCH_CAPACITIES( BM, Container, std::string )
+
+#if defined(__cpp_lib_inplace_vector)
+  #define PK_BENCH_INPLACE_VECTOR( BM ) PK_BENCH_TYPES( BM, InplaceVector )
+#else
+  #define PK_BENCH_INPLACE_VECTOR( BM )
+#endif
+
+#if defined(PK_BENCH_BOOST_STATIC_VECTOR)
+  #define PK_BENCH_STATIC_VECTOR( BM ) PK_BENCH_TYPES( BM, StaticVector )
+#else
+  #define PK_BENCH_STATIC_VECTOR( BM )
+#endif
+
+#define PK_BENCH_CONTAINERS( BM )     \
+  PK_BENCH_TYPES( BM, ArrayStack );   \
+  PK_BENCH_TYPES( BM, VectorStack );  \
+  PK_BENCH_TYPES( BM, DequeStack );   \
+  PK_BENCH_INPLACE_VECTOR( BM );      \
+  PK_BENCH_STATIC_VECTOR( BM )
+
+PK_BENCH_CONTAINERS( BM_PushPop );
+PK_BENCH_CONTAINERS( BM_PushRange );
+PK_BENCH_CONTAINERS( BM_Copy );
+PK_BENCH_CONTAINERS( BM_Swap );
+PK_BENCH_CONTAINERS( BM_Compare );
+PK_BENCH_CONTAINERS( BM_Contains );
+PK_BENCH_CONTAINERS( BM_Iterate );
@@ -0,0 +1,88 @@
+# Compiles the kernels in codegen/array_stack_codegen.cpp to assembly and checks each
+# against the instruction and branch limits in codegen/expected.txt. Run by the
+# array_stack_codegen target; see CMakeLists.txt.
+#
+# Inputs: COMPILER, COMPILER_ID (GNU, Clang or MSVC), STANDARD, SOURCE, INCLUDE_DIR,
+# EXPECTED and OUTPUT, the assembly listing
+
+cmake_minimum_required( VERSION 3.20 )
+
+if( COMPILER_ID STREQUAL "MSVC" )
+  get_filename_component( work ${OUTPUT} DIRECTORY )
+  execute_process( COMMAND ${COMPILER} /nologo /std:c++latest /O2 /DNDEBUG /EHsc /c
+                           /I${INCLUDE_DIR} /FA /Fa${OUTPUT} /Fo${work}/array_stack_codegen.obj ${SOURCE}
+                   RESULT_VARIABLE failed )
+elseif( COMPILER_ID STREQUAL "GNU" OR COMPILER_ID MATCHES "Clang" )
+  execute_process( COMMAND ${COMPILER} -std=c++${STANDARD} -O2 -DNDEBUG -I${INCLUDE_DIR}
+                           -fno-asynchronous-unwind-tables -S -o ${OUTPUT} ${SOURCE}
+                   RESULT_VARIABLE failed )
+else()
+  message( FATAL_ERROR "array_stack_codegen requires GCC, Clang or MSVC, not ${COMPILER_ID}" )
+endif()
+if( failed )
+  message( FATAL_ERROR "array_stack_codegen: ${SOURCE} failed to compile" )
+endif()
+
+# One list element per line; semicolons and brackets (MSVC memory operands) would
+# otherwise split or join elements
+file( READ ${OUTPUT} listing )
+string( REPLACE ";" "#" listing "${listing}" )
+string( REPLACE "[" "(" listing "${listing}" )
+string( REPLACE "]" ")" listing "${listing}" )
+string( REPLACE "\n" ";" lines "${listing}" )
+
+# Count the instructions of each kernel: GCC and Clang start one at "name:" and end it
+# at ".size" or the next kernel; MSVC brackets it with "name PROC" and "name ENDP"
+set( kernel "" )
+set( kernels )
+foreach( line IN LISTS lines )
+  if( line MATCHES "^(pk_[a-z_]+)(:|[ \t]+PROC)" )
+    set( kernel ${CMAKE_MATCH_1} )
+    list( APPEND kernels ${kernel} )
+    set( hot_${kernel} 0 )
+    set( branches_${kernel} 0 )
+    set( returned_${kernel} FALSE )
+  elseif( kernel AND ( line MATCHES "^[ \t]+\\.size" OR line MATCHES "ENDP" OR line MATCHES "^[A-Za-z_][A-Za-z0-9_.]*:" AND NOT line MATCHES "^\\.L" ) )
+    set( kernel "" )
+  elseif( kernel AND line MATCHES "^[ \t]+([a-z][a-z0-9.]*)" )
+    set( op ${CMAKE_MATCH_1} )
+    if( NOT returned_${kernel} )
+      math( EXPR hot_${kernel} "${hot_${kernel}} + 1" )
+    endif()
+    if( op MATCHES "^ret" )
+      set( returned_${kernel} TRUE )
+    elseif( ( op MATCHES "^j" AND NOT op STREQUAL "jmp" ) OR op MATCHES "^b\\." OR op MATCHES "^c?bn?z$" OR op MATCHES "^tbn?z$" )
+      math( EXPR branches_${kernel} "${branches_${kernel}} + 1" )
+    endif()
+  endif()
+endforeach()
+
+file( STRINGS ${EXPECTED} expected REGEX "^pk_" )
+set( report "kernel                hot/max  branches/max\n" )
+set( failures )
+foreach( entry IN LISTS expected )
+  string( REGEX REPLACE "[ \t]+" ";" fields "${entry}" )
+  list( GET fields 0 name )
+  list( GET fields 1 max_hot )
+  list( GET fields 2 max_branches )
+  if( NOT name IN_LIST kernels )
+    list( APPEND failures "${name} not found" )
+    continue()
+  endif()
+  string( LENGTH "${name}" length )
+  math( EXPR pad "22 - ${length}" )
+  string( REPEAT " " ${pad} spaces )
+  string( APPEND report "${name}${spaces}${hot_${name}}/${max_hot}      ${branches_${name}}/${max_branches}\n" )
+  if( hot_${name} GREATER max_hot )
+    list( APPEND failures "${name}: ${hot_${name}} hot instructions, limit ${max_hot}" )
+  endif()
+  if( branches_${name} GREATER max_branches )
+    list( APPEND failures "${name}: ${branches_${name}} conditional branches, limit ${max_branches}" )
+  endif()
+endforeach()
+message( "${report}" )
+
+if( failures )
+  list( JOIN failures "\n  " failures )
+  message( FATAL_ERROR "codegen regressions (see ${OUTPUT}):\n  ${failures}" )
+endif()
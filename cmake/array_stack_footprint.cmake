@@ -0,0 +1,105 @@
+# Lists the sizeof of every array_stack family container instantiated in SOURCES,
+# largest first, from the compiler's class layout dump. Run by the array_stack_footprint
+# target; see CMakeLists.txt.
+#
+# Inputs: COMPILER, COMPILER_ID (GNU or Clang), STANDARD, SOURCES, INCLUDE_DIRS,
+# DEFINITIONS, MAX_BYTES (0 for no limit) and OUTPUT, the report file
+
+cmake_minimum_required( VERSION 3.20 )
+
+set( flags -std=c++${STANDARD} -fsyntax-only )
+foreach( dir IN LISTS INCLUDE_DIRS )
+  list( APPEND flags -I${dir} )
+endforeach()
+foreach( def IN LISTS DEFINITIONS )
+  list( APPEND flags -D${def} )
+endforeach()
+
+get_filename_component( work ${OUTPUT} DIRECTORY )
+set( work ${work}/array_stack_footprint.d )
+file( REMOVE_RECURSE ${work} )
+file( MAKE_DIRECTORY ${work} )
+
+# Each layout is collected as "name|size"
+set( layouts )
+foreach( source IN LISTS SOURCES )
+  if( COMPILER_ID STREQUAL "GNU" )
+    # Writes <source>.*.class into the working directory, with entries like
+    #   Class PKIsensee::array_stack<int, 100>
+    #      size=404 align=4
+    execute_process( COMMAND ${COMPILER} ${flags} -fdump-lang-class ${source}
+                     WORKING_DIRECTORY ${work} RESULT_VARIABLE failed )
+    file( GLOB dumps ${work}/*.class )
+    set( dump )
+    foreach( file IN LISTS dumps )
+      file( READ ${file} text )
+      string( APPEND dump "${text}" )
+      file( REMOVE ${file} )
+    endforeach()
+    string( REGEX MATCHALL "Class [^\n]+\n +size=[0-9]+" entries "${dump}" )
+    foreach( entry IN LISTS entries )
+      string( REGEX REPLACE "Class ([^\n]+)\n +size=([0-9]+)" "\\1|\\2" entry "${entry}" )
+      list( APPEND layouts "${entry}" )
+    endforeach()
+  elseif( COMPILER_ID MATCHES "Clang" )
+    # Prints blocks like
+    #   *** Dumping AST Record Layout
+    #            0 | class PKIsensee::array_stack<int, 100>
+    #   ...
+    #              | [sizeof=404, dsize=404, align=4,
+    execute_process( COMMAND ${COMPILER} ${flags} -Xclang -fdump-record-layouts ${source}
+                     OUTPUT_VARIABLE dump RESULT_VARIABLE failed )
+    string( REPLACE ";" "," dump "${dump}" ) # keep CMake lists intact
+    string( REPLACE "[" "" dump "${dump}" )
+    string( REPLACE "]" "" dump "${dump}" )
+    string( REPLACE "*** Dumping AST Record Layout" ";" blocks "${dump}" )
+    foreach( block IN LISTS blocks )
+      if( block MATCHES "\\| (class|struct|union) ([^\n]+)\n" )
+        set( name "${CMAKE_MATCH_2}" )
+        if( block MATCHES "sizeof=([0-9]+)" )
+          list( APPEND layouts "${name}|${CMAKE_MATCH_1}" )
+        endif()
+      endif()
+    endforeach()
+  else()
+    message( FATAL_ERROR "array_stack_footprint requires GCC or Clang, not ${COMPILER_ID}" )
+  endif()
+  if( failed )
+    message( FATAL_ERROR "array_stack_footprint: ${source} failed to compile" )
+  endif()
+endforeach()
+
+# Keep the containers themselves, not their traits, helpers or nested classes
+set( rows )
+set( over )
+foreach( layout IN LISTS layouts )
+  string( REGEX REPLACE "\\|[0-9]+$" "" name "${layout}" )
+  string( REGEX REPLACE "^.*\\|" "" size "${layout}" )
+  if( NOT name MATCHES "^PKIsensee::(pmr::)?[a-z_]*(stack|deque|pool)<" OR name MATCHES ">::" )
+    continue()
+  endif()
+  string( LENGTH "${size}" digits )
+  math( EXPR pad "12 - ${digits}" )
+  string( REPEAT " " ${pad} spaces )
+  string( REPEAT "0" ${pad} zeros )
+  list( APPEND rows "${zeros}${size}|${spaces}${size}  ${name}" )
+  if( MAX_BYTES GREATER 0 AND size GREATER MAX_BYTES )
+    list( APPEND over "${name}" )
+  endif()
+endforeach()
+list( REMOVE_DUPLICATES rows )
+list( SORT rows ORDER DESCENDING )
+
+set( report "       bytes  instantiation\n" )
+foreach( row IN LISTS rows )
+  string( REGEX REPLACE "^[0-9]+\\|" "" row "${row}" )
+  string( APPEND report "${row}\n" )
+endforeach()
+file( WRITE ${OUTPUT} "${report}" )
+execute_process( COMMAND ${CMAKE_COMMAND} -E cat ${OUTPUT} )
+
+if( over )
+  list( REMOVE_DUPLICATES over )
+  list( JOIN over "\n  " over )
+  message( FATAL_ERROR "larger than ${MAX_BYTES} bytes:\n  ${over}" )
+endif()
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  array_stack_codegen.cpp
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  Hot-path kernels whose optimized code is checked by the array_stack_codegen
+//  target against the limits in expected.txt, so a change to array_stack.h (or a
+//  new compiler) that adds instructions or branches to push() and pop() is caught.
+//
+//  Each kernel is one operation on a stack passed by reference, with C linkage so
+//  its name is the same in every compiler's assembly listing. Release builds are
+//  checked (NDEBUG, PK_ENABLE_EXCEPTIONS not defined).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "array_stack.h"
+
+using SmallStack = PKIsensee::array_stack<int, 64>;    // uint8_t count
+using LargeStack = PKIsensee::array_stack<int, 4096>;  // uint16_t count
+
+struct ThrowTraits : PKIsensee::array_stack_traits<int, 64>
+{
+  using overflow_policy = PKIsensee::overflow::throw_;
+};
+using ThrowStack = PKIsensee::array_stack<int, 64, ThrowTraits>;
+
+extern "C"
+{
+
+// Store and increment
+void pk_push_small( SmallStack& s, int v ) noexcept
+{
+  s.push( v );
+}
+
+void pk_push_large( LargeStack& s, int v ) noexcept
+{
+  s.push( v );
+}
+
+// Decrement
+void pk_pop_small( SmallStack& s ) noexcept
+{
+  s.pop();
+}
+
+void pk_pop_large( LargeStack& s ) noexcept
+{
+  s.pop();
+}
+
+// Load
+int pk_top_small( const SmallStack& s ) noexcept
+{
+  return s.top();
+}
+
+// Load, decrement
+int pk_top_and_pop_small( SmallStack& s ) noexcept
+{
+  return s.top_and_pop();
+}
+
+// Subtract
+void pk_pop_n_small( SmallStack& s, size_t count ) noexcept
+{
+  s.pop_n( count );
+}
+
+// One compare against Capacity
+bool pk_try_push_small( SmallStack& s, int v ) noexcept
+{
+  return s.try_push( v ) != nullptr;
+}
+
+// One compare, with the throw out of line
+void pk_push_throw( ThrowStack& s, int v )
+{
+  s.push( v );
+}
+
+} // extern "C"
@@ -0,0 +1,268 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  concurrent_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  concurrent_array_stack<T, Capacity> is a lock-free stack of maximum size
+//  Capacity that any number of threads may push to and pop from concurrently.
+//
+//  Like array_stack, all storage is inline and nothing is ever allocated. The
+//  Capacity slots are linked into two Treiber stacks of slot indices: the live
+//  stack and a free list. Each list head packs a slot index with a tag that is
+//  incremented on every update, so a head that was popped and pushed back in the
+//  meantime (the ABA problem) fails the compare-exchange; see TaggedIndexList.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <utility>
+#include "array_stack.h"
+
+namespace // anonymous
+{
+
+// Lock-free Treiber stack of 32-bit indices, e.g. of the free slots of an array. The head
+// packs the top index with a tag that is incremented on every update, so a head that was
+// popped and pushed back in the meantime (the ABA problem) fails the compare-exchange.
+// The links are kept by the caller: next( i ) returns the std::atomic<Index> holding the
+// index below i. Shared by concurrent_array_stack and array_stack_pool.
+class TaggedIndexList
+{
+  static_assert( std::atomic<uint64_t>::is_always_lock_free,
+                 "TaggedIndexList requires lock-free 64-bit atomics" );
+
+public:
+
+  using Index = uint32_t;
+
+  static constexpr Index Null = std::numeric_limits<Index>::max(); // end of list
+
+  explicit TaggedIndexList( Index top ) noexcept :
+    head_( Pack( top, 0 ) )
+  {
+  }
+
+  // Snapshot; other threads may change the result before it is examined
+  Index top() const noexcept
+  {
+    return IndexOf( head_.load( std::memory_order_acquire ) );
+  }
+
+  // Returns the index removed, or Null if the list is empty
+  template <typename Next>
+  Index pop( Next&& next ) noexcept
+  {
+    auto head = head_.load( std::memory_order_acquire );
+    for( ;; )
+    {
+      const auto index = IndexOf( head );
+      if( index == Null )
+        return Null;
+      // If index is popped and reused before the exchange, its link may be stale,
+      // but the tag will have changed and the exchange fails
+      const auto below = next( index ).load( std::memory_order_relaxed );
+      if( head_.compare_exchange_weak( head, Pack( below, TagOf( head ) + 1 ),
+                                       std::memory_order_acquire, std::memory_order_acquire ) )
+        return index;
+    }
+  }
+
+  template <typename Next>
+  void push( Index index, Next&& next ) noexcept
+  {
+    auto head = head_.load( std::memory_order_relaxed );
+    for( ;; )
+    {
+      next( index ).store( IndexOf( head ), std::memory_order_relaxed );
+      if( head_.compare_exchange_weak( head, Pack( index, TagOf( head ) + 1 ),
+                                       std::memory_order_release, std::memory_order_relaxed ) )
+        return;
+    }
+  }
+
+private:
+
+  // The head is an index in the low 32 bits and an update counter in the high 32 bits
+  static constexpr uint64_t Pack( Index index, uint64_t tag ) noexcept
+  {
+    return ( tag << 32 ) | index;
+  }
+
+  static constexpr Index IndexOf( uint64_t head ) noexcept
+  {
+    return static_cast<Index>( head );
+  }
+
+  static constexpr uint64_t TagOf( uint64_t head ) noexcept
+  {
+    return head >> 32;
+  }
+
+private:
+
+  std::atomic<uint64_t> head_;
+
+};
+
+}; // namespace anonymous
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity> // stack of objects T; maximum size Capacity
+class concurrent_array_stack
+{
+  using Index = TaggedIndexList::Index;
+  static_assert( Capacity > 0 && Capacity < std::numeric_limits<Index>::max(),
+                 "Capacity must fit in a 32-bit slot index" );
+
+public:
+
+  using value_type              = T;
+  using reference               = T&;
+  using const_reference         = const T&;
+  using size_type               = size_t;
+
+  concurrent_array_stack() noexcept
+  {
+    // Initially every slot is on the free list
+    for( Index i = 0; i < Capacity; ++i )
+      slots_[i].next.store( i + 1, std::memory_order_relaxed );
+    slots_[Capacity-1].next.store( Null, std::memory_order_relaxed );
+  }
+
+  concurrent_array_stack( const concurrent_array_stack& ) = delete;
+  concurrent_array_stack& operator=( const concurrent_array_stack& ) = delete;
+
+  ~concurrent_array_stack()
+  {
+    // No other thread may be using the stack at this point
+    for( auto i = live_.top(); i != Null; i = slots_[i].next.load() )
+      std::destroy_at( &slots_[i].value );
+  }
+
+  // Snapshots; other threads may change the result before it is examined
+
+  bool empty() const noexcept
+  {
+    return live_.top() == Null;
+  }
+
+  bool full() const noexcept
+  {
+    return free_.top() == Null;
+  }
+
+  // There is deliberately no size(); maintaining a count would add a second
+  // heavily contended atomic to every push and pop
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  // Each operation below returns false if the stack was full (push) or
+  // empty (pop) and leaves the stack unchanged
+
+  bool try_push( const value_type& v )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    return try_emplace( v );
+  }
+
+  bool try_push( value_type&& v )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    return try_emplace( std::move( v ) );
+  }
+
+  template <class... Types>
+  bool try_emplace( Types&&... values )
+    noexcept( std::is_nothrow_constructible_v<T, Types...> )
+  {
+    SlotGuard slot{ *this, free_ }; // slot returns to the free list if construction throws
+    if( slot.index == Null )
+      return false;
+    std::construct_at( &slots_[slot.index].value, std::forward<Types>( values )... );
+    live_.push( slot.release(), Links() );
+    return true;
+  }
+
+  bool try_pop( value_type& v )
+    noexcept( std::is_nothrow_move_assignable_v<T> )
+  {
+    SlotGuard slot{ *this, live_ }; // slot returns to the stack if the move throws
+    if( slot.index == Null )
+      return false;
+    auto& element = slots_[slot.index].value;
+    v = std::move( element );
+    std::destroy_at( &element );
+    free_.push( slot.release(), Links() );
+    return true;
+  }
+
+private:
+
+  static constexpr Index Null = TaggedIndexList::Null;
+
+  // Each slot links to the one below it, on whichever list it's on
+  auto Links() noexcept
+  {
+    return [this]( Index i ) -> std::atomic<Index>& { return slots_[i].next; };
+  }
+
+  // Slot taken from a list, pushed back onto the same list on scope exit unless released
+  struct SlotGuard
+  {
+    concurrent_array_stack& stack;
+    TaggedIndexList& list;
+    Index index = list.pop( stack.Links() );
+
+    ~SlotGuard()
+    {
+      if( index != Null )
+        list.push( index, stack.Links() );
+    }
+
+    Index release() noexcept
+    {
+      return std::exchange( index, Null );
+    }
+  };
+
+  struct Slot
+  {
+    Slot() noexcept {}
+    ~Slot() {}
+
+    std::atomic<Index> next;
+    union
+    {
+      T value; // alive only while the slot is on the live stack
+    };
+  };
+
+private:
+
+  // The list heads are the only contended data; each gets its own cache line so
+  // they don't falsely share with each other or with the slots
+
+  alignas( CacheLine ) TaggedIndexList live_ { Null };
+  alignas( CacheLine ) TaggedIndexList free_ { 0 };
+  alignas( CacheLine ) std::array<Slot, Capacity> slots_;
+
+}; // class concurrent_array_stack
+
+} // namespace PKIsensee
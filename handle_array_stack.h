@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  handle_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  handle_array_stack<T, Capacity, Generation> is an array_stack whose elements
+//  can be referred to by handles that detect when the element is gone. Elements
+//  never move, so a pointer to one stays valid while it is on the stack, but once
+//  it's popped, the next push reuses its slot and the pointer silently refers to
+//  the new element. A handle doesn't:
+//
+//    handle_array_stack<Scope, 256> scopes;
+//    scopes.push( outer );
+//    auto h = scopes.handle( scopes.size() - 1 );
+//    scopes.pop();
+//    scopes.push( inner );
+//    scopes.get( h ); // nullptr
+//
+//  Beside the elements is an array counting how many times each slot has been
+//  pushed to, its generation. A handle is an index plus the generation it was taken
+//  at, and get() is an index, a compare, and a compare with size(). The storage is a
+//  policy, so handle_array_stack is array_stack with different traits.
+//
+//  Handles follow slots, as pointers do, through assignment and swap. A default
+//  constructed handle refers to nothing. A Generation wraps after 2^bits pushes to
+//  one slot, when a handle that old could match again.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+// Refers to the element at index, if its slot is still at generation
+template <typename Index, typename Generation>
+struct array_stack_handle
+{
+  Index index = 0;
+  Generation generation = 0;
+
+  constexpr bool operator==( const array_stack_handle& ) const noexcept = default;
+};
+
+} // namespace PKIsensee
+
+namespace // anonymous
+{
+
+// InlineStorage that counts the pushes to each slot
+template <typename T, size_t N, typename Generation>
+class GenerationalStorage
+{
+  static_assert( std::is_unsigned_v<Generation>, "Generation must be unsigned" );
+
+public:
+
+  using handle_type = PKIsensee::array_stack_handle<SmallestUnsigned<N>, Generation>;
+
+  GenerationalStorage() = default;
+
+  // The owning array_stack copies the elements; a copy's slots start over at generation 0
+  constexpr GenerationalStorage( const GenerationalStorage& ) noexcept
+  {
+  }
+
+  constexpr GenerationalStorage& operator=( const GenerationalStorage& ) noexcept
+  {
+    return *this;
+  }
+
+  constexpr T* data() noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  constexpr const T* data() const noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  // Slots [size_, size) are about to be pushed to, which starts their next generation
+  constexpr void resize( size_t size ) noexcept
+  {
+    for( size_t i = size_; i < size; ++i )
+      ++generations_[i];
+    size_ = static_cast<SmallestUnsigned<N>>( size );
+  }
+
+  constexpr handle_type handle( size_t i ) const noexcept
+  {
+    return { static_cast<SmallestUnsigned<N>>( i ), generations_[i] };
+  }
+
+  // Index of the slot h refers to, or N if it has been pushed to since
+  constexpr size_t index( const handle_type& h ) const noexcept
+  {
+    return ( h.index < N && generations_[h.index] == h.generation ) ? h.index : N;
+  }
+
+private:
+
+  InlineStorage<T, N> c_;
+  std::array<Generation, N> generations_ = {};
+  SmallestUnsigned<N> size_ = 0; // slots in use, as last resized by the owner
+
+};
+
+template <typename T, size_t N, typename Generation>
+constexpr T* StorageData( GenerationalStorage<T, N, Generation>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N, typename Generation>
+constexpr const T* StorageData( const GenerationalStorage<T, N, Generation>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N, typename Generation>
+constexpr void StorageResize( GenerationalStorage<T, N, Generation>& storage, size_t size ) noexcept
+{
+  storage.resize( size );
+}
+
+template <typename T, size_t N, typename Generation>
+constexpr auto StorageHandle( const GenerationalStorage<T, N, Generation>& storage, size_t i ) noexcept
+{
+  return storage.handle( i );
+}
+
+template <typename T, size_t N, typename Generation>
+constexpr size_t StorageIndex( const GenerationalStorage<T, N, Generation>& storage,
+                               const typename GenerationalStorage<T, N, Generation>::handle_type& h ) noexcept
+{
+  return storage.index( h );
+}
+
+}; // namespace anonymous
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity, typename Generation = uint32_t>
+struct handle_array_stack_traits : array_stack_traits<T, Capacity>
+{
+  using storage_type = GenerationalStorage<T, Capacity, Generation>;
+  using handle_type = typename storage_type::handle_type;
+};
+
+template <typename T, size_t Capacity, typename Generation = uint32_t>
+using handle_array_stack = array_stack<T, Capacity, handle_array_stack_traits<T, Capacity, Generation>>;
+
+} // namespace PKIsensee
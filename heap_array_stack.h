@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  heap_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  heap_array_stack<T, Capacity, Allocator> is an array_stack whose Capacity
+//  elements live in a heap buffer instead of inline, for stacks too large for a
+//  thread's stack.
+//
+//  The buffer is allocated when the stack is constructed and never grows, so
+//  push() and pop() are the same as array_stack's. It's a storage policy, so
+//  heap_array_stack is array_stack with different traits:
+//
+//    heap_array_stack<Node, 100'000> nodes;                // std::allocator
+//    pmr::heap_array_stack<Node, 100'000> arena( &pool );  // memory_resource
+//
+//  A copy allocates its own buffer, from the allocator that
+//  select_on_container_copy_construction() gives, and copies the live elements.
+//  A move takes the buffer and the allocator, so it's O(1) and never allocates;
+//  the moved-from stack is empty, and allocates a buffer again if it's pushed to.
+//
+//  Assignment and swap propagate the allocator as the standard containers do: only
+//  if propagate_on_container_copy_assignment, _move_assignment or _swap says so,
+//  and then the buffer goes with it. Otherwise each stack keeps its allocator, which
+//  is what pmr allocators want, and move assignment and swap exchange buffers only
+//  when the allocators compare equal, moving the elements when they don't.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <memory_resource>
+#include "array_stack.h"
+
+namespace // anonymous
+{
+
+// Storage for N objects T in a buffer allocated once from Allocator
+template <typename T, size_t N, typename Allocator>
+class HeapStorage
+{
+  using AllocTraits = std::allocator_traits<Allocator>;
+  static_assert( std::is_same_v<typename AllocTraits::value_type, T>,
+                 "Allocator::value_type must be T" );
+
+public:
+
+  using allocator_type = Allocator;
+
+  constexpr HeapStorage() :
+    HeapStorage( Allocator() )
+  {
+  }
+
+  constexpr explicit HeapStorage( const Allocator& alloc ) :
+    alloc_( alloc ),
+    data_( AllocTraits::allocate( alloc_, N ) )
+  {
+  }
+
+  // The owning array_stack copies the elements; storage only provides a buffer
+  constexpr HeapStorage( const HeapStorage& rhs ) :
+    HeapStorage( AllocTraits::select_on_container_copy_construction( rhs.alloc_ ) )
+  {
+  }
+
+  // Takes the buffer of rhs, elements and all
+  constexpr HeapStorage( HeapStorage&& rhs ) noexcept :
+    alloc_( std::move( rhs.alloc_ ) ),
+    data_( std::exchange( rhs.data_, nullptr ) )
+  {
+  }
+
+  // Assignment keeps the buffer, and the allocator unless it propagates on copy
+  // assignment; a buffer from a different allocator is released, so it must be empty
+  constexpr HeapStorage& operator=( const HeapStorage& rhs ) noexcept
+  {
+    if constexpr( AllocTraits::propagate_on_container_copy_assignment::value )
+    {
+      if( !AllocTraits::is_always_equal::value && alloc_ != rhs.alloc_ )
+        Release();
+      alloc_ = rhs.alloc_;
+    }
+    return *this;
+  }
+
+  constexpr ~HeapStorage()
+  {
+    Release();
+  }
+
+  constexpr T* data() noexcept
+  {
+    return data_;
+  }
+
+  constexpr const T* data() const noexcept
+  {
+    return data_;
+  }
+
+  // Storage that was moved from has no buffer until elements are added again
+  constexpr void resize( size_t size )
+  {
+    if( data_ == nullptr && size > 0 )
+      data_ = AllocTraits::allocate( alloc_, N );
+  }
+
+  // Takes the buffer of rhs, leaving rhs with this one, if the allocator propagates on
+  // move assignment or the two are equal and can free each other's buffers; this
+  // buffer must be empty
+  constexpr bool take( HeapStorage& rhs ) noexcept
+  {
+    if constexpr( AllocTraits::propagate_on_container_move_assignment::value )
+    {
+      Release();
+      alloc_ = rhs.alloc_;
+      data_ = std::exchange( rhs.data_, nullptr );
+      return true;
+    }
+    else
+      return swap( rhs );
+  }
+
+  // Exchanges buffers, and allocators if they propagate on swap; unequal allocators
+  // that don't can't exchange buffers
+  constexpr bool swap( HeapStorage& rhs ) noexcept
+  {
+    if constexpr( AllocTraits::propagate_on_container_swap::value )
+    {
+      using std::swap;
+      swap( alloc_, rhs.alloc_ );
+    }
+    else if constexpr( !AllocTraits::is_always_equal::value )
+    {
+      if( alloc_ != rhs.alloc_ )
+        return false;
+    }
+    std::swap( data_, rhs.data_ );
+    return true;
+  }
+
+private:
+
+  constexpr void Release() noexcept
+  {
+    if( data_ != nullptr )
+      AllocTraits::deallocate( alloc_, std::exchange( data_, nullptr ), N );
+  }
+
+private:
+
+  PK_NO_UNIQUE_ADDRESS Allocator alloc_;
+  T* data_;
+
+};
+
+template <typename T, size_t N, typename Allocator>
+constexpr T* StorageData( HeapStorage<T, N, Allocator>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N, typename Allocator>
+constexpr const T* StorageData( const HeapStorage<T, N, Allocator>& storage ) noexcept
+{
+  return storage.data();
+}
+
+template <typename T, size_t N, typename Allocator>
+constexpr void StorageResize( HeapStorage<T, N, Allocator>& storage, size_t size )
+{
+  storage.resize( size );
+}
+
+template <typename T, size_t N, typename Allocator>
+constexpr bool StorageTake( HeapStorage<T, N, Allocator>& lhs, HeapStorage<T, N, Allocator>& rhs ) noexcept
+{
+  return lhs.take( rhs );
+}
+
+template <typename T, size_t N, typename Allocator>
+constexpr bool StorageSwap( HeapStorage<T, N, Allocator>& lhs, HeapStorage<T, N, Allocator>& rhs ) noexcept
+{
+  return lhs.swap( rhs );
+}
+
+}; // namespace anonymous
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity, typename Allocator = std::allocator<T>>
+struct heap_array_stack_traits : array_stack_traits<T, Capacity>
+{
+  using storage_type = HeapStorage<T, Capacity, Allocator>;
+};
+
+template <typename T, size_t Capacity, typename Allocator = std::allocator<T>>
+using heap_array_stack = array_stack<T, Capacity, heap_array_stack_traits<T, Capacity, Allocator>>;
+
+namespace pmr
+{
+
+template <typename T, size_t Capacity>
+using heap_array_stack = PKIsensee::heap_array_stack<T, Capacity, std::pmr::polymorphic_allocator<T>>;
+
+} // namespace pmr
+
+} // namespace PKIsensee
@@ -0,0 +1,562 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  inplace_or_heap_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  inplace_or_heap_stack<T, InlineCapacity, Allocator> is an array_stack that
+//  doesn't overflow.
+//
+//  The first InlineCapacity elements are stored inline, exactly like array_stack.
+//  Pushing beyond InlineCapacity moves the elements to a heap buffer obtained from
+//  Allocator that grows geometrically. shrink_to_fit() moves the elements back
+//  inline once they fit again.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <utility>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+template <typename T, size_t InlineCapacity, typename Allocator = std::allocator<T>>
+class inplace_or_heap_stack
+{
+  using AllocTraits = std::allocator_traits<Allocator>;
+  static_assert( std::is_same_v<typename AllocTraits::value_type, T>,
+                 "Allocator::value_type must be T" );
+  static_assert( InlineCapacity > 0, "InlineCapacity must be non-zero" );
+  static_assert( sizeof( InlineStorage<T, InlineCapacity> ) <= MaxStackBytes,
+                 "inplace_or_heap_stack exceeds PK_ARRAY_STACK_MAX_BYTES; reduce InlineCapacity" );
+
+public:
+
+  using value_type              = T;
+  using allocator_type          = Allocator;
+  using reference               = T&;
+  using const_reference         = const T&;
+  using pointer                 = T*;
+  using const_pointer           = const T*;
+  using iterator                = pointer;
+  using const_iterator          = const_pointer;
+  using reverse_iterator        = std::reverse_iterator<iterator>;
+  using const_reverse_iterator  = std::reverse_iterator<const_iterator>;
+  using size_type               = size_t;
+
+  inplace_or_heap_stack() = default;
+
+  constexpr explicit inplace_or_heap_stack( const Allocator& alloc ) noexcept :
+    alloc_( alloc )
+  {
+  }
+
+  template <typename InIt>
+  constexpr inplace_or_heap_stack( InIt first, InIt last, const Allocator& alloc = Allocator() ) :
+    alloc_( alloc )
+  {
+    const auto count = static_cast<size_type>( std::distance( first, last ) );
+    reserve( count );
+    ConstructAtTop( first, count );
+  }
+
+#if defined(__cpp_lib_containers_ranges)
+  template <typename Range>
+  constexpr inplace_or_heap_stack( std::from_range_t, Range&& rng, const Allocator& alloc = Allocator() ) :
+    alloc_( alloc )
+  {
+    push_range( std::forward<Range>( rng ) );
+  }
+#endif
+
+  constexpr inplace_or_heap_stack( const inplace_or_heap_stack& rhs ) :
+    alloc_( AllocTraits::select_on_container_copy_construction( rhs.alloc_ ) )
+  {
+    reserve( rhs.size_ );
+    ConstructAtTop( rhs.data_, rhs.size_ );
+  }
+
+  constexpr inplace_or_heap_stack( inplace_or_heap_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> ) :
+    alloc_( std::move( rhs.alloc_ ) )
+  {
+    TakeElements( rhs );
+  }
+
+  constexpr inplace_or_heap_stack& operator=( const inplace_or_heap_stack& rhs )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      if constexpr( AllocTraits::propagate_on_container_copy_assignment::value )
+      {
+        if( alloc_ != rhs.alloc_ )
+          ReleaseHeap();
+        alloc_ = rhs.alloc_;
+      }
+      reserve( rhs.size_ );
+      ConstructAtTop( rhs.data_, rhs.size_ );
+    }
+    return *this;
+  }
+
+  constexpr inplace_or_heap_stack& operator=( inplace_or_heap_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> &&
+              ( AllocTraits::propagate_on_container_move_assignment::value ||
+                AllocTraits::is_always_equal::value ) )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      ReleaseHeap();
+      if constexpr( AllocTraits::propagate_on_container_move_assignment::value )
+        alloc_ = std::move( rhs.alloc_ );
+      TakeElements( rhs );
+    }
+    return *this;
+  }
+
+  constexpr ~inplace_or_heap_stack()
+  {
+    clear();
+    ReleaseHeap();
+  }
+
+  constexpr allocator_type get_allocator() const noexcept
+  {
+    return alloc_;
+  }
+
+  constexpr iterator begin() noexcept
+  {
+    return data_;
+  }
+
+  constexpr const_iterator begin() const noexcept
+  {
+    return data_;
+  }
+
+  constexpr const_iterator cbegin() const noexcept
+  {
+    return begin();
+  }
+
+  constexpr iterator end() noexcept
+  {
+    return data_ + size_;
+  }
+
+  constexpr const_iterator end() const noexcept
+  {
+    return data_ + size_;
+  }
+
+  constexpr const_iterator cend() const noexcept
+  {
+    return end();
+  }
+
+  constexpr reverse_iterator rbegin() noexcept
+  {
+    return reverse_iterator( end() );
+  }
+
+  constexpr const_reverse_iterator rbegin() const noexcept
+  {
+    return const_reverse_iterator( end() );
+  }
+
+  constexpr const_reverse_iterator crbegin() const noexcept
+  {
+    return rbegin();
+  }
+
+  constexpr reverse_iterator rend() noexcept
+  {
+    return reverse_iterator( begin() );
+  }
+
+  constexpr const_reverse_iterator rend() const noexcept
+  {
+    return const_reverse_iterator( begin() );
+  }
+
+  constexpr const_reverse_iterator crend() const noexcept
+  {
+    return rend();
+  }
+
+  constexpr std::ranges::subrange<reverse_iterator> top_down() noexcept
+  {
+    return { rbegin(), rend() };
+  }
+
+  constexpr std::ranges::subrange<const_reverse_iterator> top_down() const noexcept
+  {
+    return { rbegin(), rend() };
+  }
+
+  constexpr bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  // True when the next push must allocate
+  constexpr bool full() const noexcept
+  {
+    return size_ == capacity_;
+  }
+
+  // True while the elements are stored inline
+  constexpr bool is_inline() const noexcept
+  {
+    return data_ == StorageData( inline_ );
+  }
+
+  constexpr size_type size() const noexcept
+  {
+    return size_;
+  }
+
+  constexpr size_type capacity() const noexcept
+  {
+    return capacity_;
+  }
+
+  static constexpr size_type inline_capacity() noexcept
+  {
+    return InlineCapacity;
+  }
+
+  constexpr void reserve( size_type newCapacity )
+  {
+    if( newCapacity > capacity_ )
+      Reallocate( newCapacity );
+  }
+
+  // Move the elements back inline if they fit, releasing the heap buffer
+  constexpr void shrink_to_fit()
+  {
+    if( is_inline() || size_ > InlineCapacity )
+      return;
+    const auto heap = data_;
+    const auto heapCapacity = capacity_;
+    Relocate( StorageData( inline_ ) );
+    AllocTraits::deallocate( alloc_, heap, heapCapacity );
+    capacity_ = InlineCapacity;
+  }
+
+  constexpr void clear() noexcept
+  {
+    std::destroy( begin(), end() );
+    size_ = 0;
+  }
+
+  constexpr reference top() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return data_[size_-1];
+  }
+
+  constexpr const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return data_[size_-1];
+  }
+
+  constexpr void push( const value_type& v )
+  {
+    emplace( v );
+  }
+
+  constexpr void push( value_type&& v )
+  {
+    emplace( std::move( v ) );
+  }
+
+  template <typename Range>
+  constexpr void push_range( Range&& rng )
+  {
+    const auto count = static_cast<size_type>( std::size( rng ) );
+    if( count > capacity_ - size_ )
+      Reallocate( std::max( size_ + count, capacity_ * 2 ) );
+    ConstructAtTop( ForwardFrom<T>( std::forward<Range>( rng ) ), count );
+  }
+
+  template <class... Types>
+  constexpr decltype(auto) emplace( Types&&... values )
+  {
+    if( full() )
+      return EmplaceAndGrow( std::forward<Types>( values )... );
+    const auto dest = std::construct_at( data_ + size_, std::forward<Types>( values )... );
+    ++size_;
+    return *dest;
+  }
+
+  constexpr void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    --size_;
+    std::destroy_at( data_ + size_ );
+  }
+
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack( count );
+    DestroyTop( count );
+  }
+
+  template <typename OutIt>
+  constexpr OutIt pop_into( OutIt dest, size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack( count );
+    const auto first = rbegin();
+    dest = std::ranges::move( first, first + static_cast<ptrdiff_t>( count ), dest ).out;
+    DestroyTop( count );
+    return dest;
+  }
+
+  constexpr bool try_pop( value_type& v )
+    noexcept( std::is_nothrow_move_assignable_v<T> )
+  {
+    if( empty() )
+      return false;
+    v = std::move( data_[size_-1] );
+    DestroyTop(1);
+    return true;
+  }
+
+  constexpr value_type top_and_pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    value_type v = std::move( data_[size_-1] );
+    DestroyTop(1);
+    return v;
+  }
+
+  constexpr void swap( inplace_or_heap_stack& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> &&
+              ( AllocTraits::propagate_on_container_move_assignment::value ||
+                AllocTraits::is_always_equal::value ) )
+  {
+    if( !is_inline() && !rhs.is_inline() )
+    {
+      // Both on the heap; exchange buffers
+      if constexpr( AllocTraits::propagate_on_container_swap::value )
+        std::swap( alloc_, rhs.alloc_ );
+      std::swap( data_, rhs.data_ );
+      std::swap( size_, rhs.size_ );
+      std::swap( capacity_, rhs.capacity_ );
+      return;
+    }
+    inplace_or_heap_stack temp( std::move( rhs ) );
+    rhs = std::move( *this );
+    *this = std::move( temp );
+  }
+
+  constexpr const_reference operator[]( size_type i ) const noexcept
+  {
+    PK_ASSERT( i < size() );
+    return data_[i];
+  }
+
+  constexpr reference operator[]( size_type i ) noexcept
+  {
+    PK_ASSERT( i < size() );
+    return data_[i];
+  }
+
+  constexpr bool contains( const value_type& v ) const noexcept
+  {
+    return FindFirst( data_, size_, v ) != size_;
+  }
+
+  // Topmost element equal to v, or end() if there is none
+  constexpr iterator find_from_top( const value_type& v ) noexcept
+  {
+    return begin() + FindLast( data_, size_, v );
+  }
+
+  constexpr const_iterator find_from_top( const value_type& v ) const noexcept
+  {
+    return begin() + FindLast( data_, size_, v );
+  }
+
+  constexpr bool operator==( const inplace_or_heap_stack& rhs ) const noexcept
+  {
+    if( size_ != rhs.size_ ) // different sized stacks are not equal
+      return false;
+    return EqualElements( data_, rhs.data_, size_ );
+  }
+
+  constexpr auto operator<=>( const inplace_or_heap_stack& rhs ) const noexcept
+  {
+    return CompareElements( data_, size_, rhs.data_, rhs.size_ );
+  }
+
+private:
+
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, size() );
+  }
+
+  // Heap buffer that is released on scope exit unless ownership is taken, along
+  // with the single element already constructed in it, if any
+  struct HeapBuffer
+  {
+    Allocator& alloc;
+    size_type capacity;
+    pointer p = AllocTraits::allocate( alloc, capacity );
+    pointer element = nullptr;
+
+    constexpr ~HeapBuffer()
+    {
+      if( p == nullptr )
+        return;
+      if( element != nullptr )
+        std::destroy_at( element );
+      AllocTraits::deallocate( alloc, p, capacity );
+    }
+
+    constexpr pointer release() noexcept
+    {
+      return std::exchange( p, nullptr );
+    }
+  };
+
+  // Construct count elements from first into the slots at the top of the stack
+  template <typename InIt>
+  constexpr void ConstructAtTop( InIt first, size_type count )
+  {
+    assert( size_ + count <= capacity_ );
+    UninitializedCopy( first, count, data_ + size_ );
+    size_ += count;
+  }
+
+  // std::uninitialized_copy_n, usable during constant evaluation
+  template <typename InIt>
+  static constexpr void UninitializedCopy( InIt first, size_type count, pointer dest )
+  {
+    if( !std::is_constant_evaluated() )
+    {
+      std::uninitialized_copy_n( first, count, dest );
+      return;
+    }
+    for( ; count > 0; --count, ++first, ++dest )
+      std::construct_at( dest, *first );
+  }
+
+  // Destroy the top count elements, top first, as array_stack does
+  constexpr void DestroyTop( size_type count ) noexcept
+  {
+    if constexpr( !std::is_trivially_destructible_v<T> )
+      std::destroy( rbegin(), rbegin() + static_cast<ptrdiff_t>( count ) );
+    size_ -= count;
+  }
+
+  // Move the elements to dest (moves if that can't throw, otherwise copies) and
+  // destroy the originals
+  constexpr void Relocate( pointer dest )
+  {
+    if constexpr( std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T> )
+      UninitializedCopy( std::make_move_iterator( data_ ), size_, dest );
+    else
+      UninitializedCopy( data_, size_, dest );
+    std::destroy_n( data_, size_ );
+    data_ = dest;
+  }
+
+  constexpr void Reallocate( size_type newCapacity )
+  {
+    HeapBuffer buffer{ alloc_, newCapacity };
+    const auto oldData = data_;
+    const auto oldCapacity = capacity_;
+    Relocate( buffer.p );
+    buffer.release();
+    capacity_ = newCapacity;
+    if( oldData != StorageData( inline_ ) )
+      AllocTraits::deallocate( alloc_, oldData, oldCapacity );
+  }
+
+  // Slow path of emplace(). The new element is constructed before the existing
+  // elements move, so values that refer to an element of this stack remain valid.
+  template <class... Types>
+  constexpr reference EmplaceAndGrow( Types&&... values )
+  {
+    HeapBuffer buffer{ alloc_, capacity_ * 2 };
+    const auto dest = std::construct_at( buffer.p + size_, std::forward<Types>( values )... );
+    buffer.element = dest;
+    const auto oldData = data_;
+    const auto oldCapacity = capacity_;
+    Relocate( buffer.p );
+    buffer.release();
+    capacity_ *= 2;
+    ++size_;
+    if( oldData != StorageData( inline_ ) )
+      AllocTraits::deallocate( alloc_, oldData, oldCapacity );
+    return *dest;
+  }
+
+  // Take the elements of a stack whose own storage is inaccessible; rhs is left empty.
+  // A heap buffer is stolen whenever the allocators are interchangeable.
+  constexpr void TakeElements( inplace_or_heap_stack& rhs )
+  {
+    if( !rhs.is_inline() && alloc_ == rhs.alloc_ )
+    {
+      data_ = std::exchange( rhs.data_, StorageData( rhs.inline_ ) );
+      size_ = std::exchange( rhs.size_, 0 );
+      capacity_ = std::exchange( rhs.capacity_, InlineCapacity );
+      return;
+    }
+    reserve( rhs.size_ );
+    ConstructAtTop( std::make_move_iterator( rhs.data_ ), rhs.size_ );
+    rhs.clear();
+  }
+
+  // Return to inline storage; the stack must be empty
+  constexpr void ReleaseHeap() noexcept
+  {
+    assert( empty() );
+    if( is_inline() )
+      return;
+    AllocTraits::deallocate( alloc_, data_, capacity_ );
+    data_ = StorageData( inline_ );
+    capacity_ = InlineCapacity;
+  }
+
+private:
+
+  // data_ points at inline_ until the stack outgrows InlineCapacity, then at a heap
+  // buffer of capacity_ elements
+  // push(x) -> construct data_[size_] from x; ++size_;
+  // pop()   -> --size_; destroy data_[size_];
+
+  pointer data_ = StorageData( inline_ );
+  size_type size_ = 0;
+  size_type capacity_ = InlineCapacity;
+  PK_NO_UNIQUE_ADDRESS Allocator alloc_;
+  InlineStorage<T, InlineCapacity> inline_;
+
+}; // class inplace_or_heap_stack
+
+template <typename T, size_t InlineCapacity, typename Allocator>
+void constexpr swap( inplace_or_heap_stack<T, InlineCapacity, Allocator>& lhs,
+                     inplace_or_heap_stack<T, InlineCapacity, Allocator>& rhs ) noexcept( noexcept( lhs.swap( rhs ) ) )
+{
+  lhs.swap( rhs );
+}
+
+} // namespace PKIsensee
@@ -0,0 +1,393 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  mapped_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  mapped_array_stack<T, Capacity> is an array_stack of trivially copyable objects
+//  whose element count and elements live in a memory-mapped file, so the stack
+//  survives the process. Reopening the file maps it and the stack is back, with
+//  nothing to replay:
+//
+//    auto undo = mapped_array_stack<Edit, 1'000'000>::open( "undo.log" );
+//    if( !undo ) ... // not a stack of this type
+//    undo->push( edit );
+//    undo->flush(); // durable even if the machine fails
+//
+//  push() and pop() are plain memory writes. They keep the same invariant as
+//  array_stack: push() writes c_[top_], then increments top_, and top_ is stored
+//  with release semantics, so if the process dies the file never counts an element
+//  that wasn't written. Surviving a machine failure needs flush(), which writes the
+//  elements back to the file before the count.
+//
+//  The file begins with a header page holding an array_stack_snapshot_header,
+//  whose size is top_; the elements follow at offset HeaderBytes.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include "array_stack_snapshot.h"
+
+#if defined(_WIN32)
+  #if !defined(WIN32_LEAN_AND_MEAN)
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #if !defined(NOMINMAX)
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity> // stack of objects T; maximum size Capacity
+class mapped_array_stack
+{
+  static_assert( std::is_trivially_copyable_v<T>, "mapped_array_stack requires trivially copyable T" );
+
+public:
+
+  using value_type              = T;
+  using reference               = T&;
+  using const_reference         = const T&;
+  using pointer                 = T*;
+  using const_pointer           = const T*;
+  using iterator                = pointer;
+  using const_iterator          = const_pointer;
+  using size_type               = size_t;
+
+  // Elements start on their own page, even with 16KB pages, so flushing them
+  // doesn't also flush the element count
+  static constexpr size_t HeaderBytes = 16384;
+  static constexpr size_t FileBytes = HeaderBytes + Capacity * sizeof( T );
+
+  static_assert( alignof( T ) <= HeaderBytes, "T is too strictly aligned" );
+
+  // Maps the stack stored in the file at path, creating an empty stack if there is no
+  // file. Returns nothing if the file can't be opened or mapped, or holds anything
+  // other than a mapped_array_stack<T, Capacity> written on a machine like this one.
+  static std::optional<mapped_array_stack> open( const std::filesystem::path& path )
+  {
+    mapped_array_stack s;
+    if( !s.Map( path ) || !s.ValidHeader() )
+      return std::nullopt;
+    return s;
+  }
+
+  mapped_array_stack( mapped_array_stack&& rhs ) noexcept :
+    base_( std::exchange( rhs.base_, nullptr ) )
+#if defined(_WIN32)
+  , file_( std::exchange( rhs.file_, INVALID_HANDLE_VALUE ) ),
+    mapping_( std::exchange( rhs.mapping_, nullptr ) )
+#else
+  , file_( std::exchange( rhs.file_, -1 ) )
+#endif
+  {
+  }
+
+  mapped_array_stack& operator=( mapped_array_stack&& rhs ) noexcept
+  {
+    if( this != &rhs )
+    {
+      Unmap();
+      base_ = std::exchange( rhs.base_, nullptr );
+#if defined(_WIN32)
+      file_ = std::exchange( rhs.file_, INVALID_HANDLE_VALUE );
+      mapping_ = std::exchange( rhs.mapping_, nullptr );
+#else
+      file_ = std::exchange( rhs.file_, -1 );
+#endif
+    }
+    return *this;
+  }
+
+  mapped_array_stack( const mapped_array_stack& ) = delete;
+  mapped_array_stack& operator=( const mapped_array_stack& ) = delete;
+
+  // Unmapping doesn't flush; the operating system writes the pages back eventually
+  ~mapped_array_stack()
+  {
+    Unmap();
+  }
+
+  iterator begin() noexcept
+  {
+    return Data();
+  }
+
+  const_iterator begin() const noexcept
+  {
+    return Data();
+  }
+
+  iterator end() noexcept
+  {
+    return Data() + size();
+  }
+
+  const_iterator end() const noexcept
+  {
+    return Data() + size();
+  }
+
+  bool empty() const noexcept
+  {
+    return size() == 0;
+  }
+
+  bool full() const noexcept
+  {
+    return size() == Capacity;
+  }
+
+  size_type size() const noexcept
+  {
+    return static_cast<size_type>( Top().load( std::memory_order_relaxed ) );
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  void clear() noexcept
+  {
+    SetTop( 0 );
+  }
+
+  reference top() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[size() - 1];
+  }
+
+  const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[size() - 1];
+  }
+
+  void push( const value_type& v ) PK_MAY_THROW
+  {
+    const auto top = size();
+    CheckForFullStack(1);
+    Data()[top] = v;
+    SetTop( top + 1 );
+  }
+
+  // Returns false, leaving the stack unchanged, if the stack is full
+  bool try_push( const value_type& v ) noexcept
+  {
+    const auto top = size();
+    if( top == Capacity )
+      return false;
+    Data()[top] = v;
+    SetTop( top + 1 );
+    return true;
+  }
+
+  void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    SetTop( size() - 1 );
+  }
+
+  void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack( count );
+    SetTop( size() - count );
+  }
+
+  reference operator[]( size_type i ) noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[i];
+  }
+
+  const_reference operator[]( size_type i ) const noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[i];
+  }
+
+  // Durability barrier: waits until the elements, and then the element count, have been
+  // written to the file. Returns false if either write failed.
+  bool flush() noexcept
+  {
+    return Sync( HeaderBytes, FileBytes - HeaderBytes ) && flush_top();
+  }
+
+  // Waits until the element count has been written to the file, e.g. after pop(), when
+  // the elements are unchanged
+  bool flush_top() noexcept
+  {
+    return Sync( 0, sizeof( array_stack_snapshot_header ) );
+  }
+
+private:
+
+  mapped_array_stack() = default;
+
+  void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, size() );
+  }
+
+  void CheckForFullStack( size_t elementsToAdd ) const
+  {
+    CheckElementsToAdd<overflow::default_>( elementsToAdd, size(), capacity() );
+  }
+
+  array_stack_snapshot_header& Header() const noexcept
+  {
+    return *std::launder( reinterpret_cast<array_stack_snapshot_header*>( base_ ) );
+  }
+
+  // The element count is the header's size field. Storing it with release semantics
+  // keeps writes to the elements ahead of it.
+  std::atomic_ref<uint64_t> Top() const noexcept
+  {
+    return std::atomic_ref<uint64_t>( Header().size );
+  }
+
+  void SetTop( size_t top ) noexcept
+  {
+    Top().store( top, std::memory_order_release );
+  }
+
+  T* Data() const noexcept
+  {
+    return reinterpret_cast<T*>( base_ + HeaderBytes );
+  }
+
+  // A new file is all zeros, which has no magic value, and receives a header for an empty stack
+  bool ValidHeader() noexcept
+  {
+    auto& header = Header();
+    const auto expected = make_snapshot_header<T, Capacity>( 0 );
+    if( header.magic == 0 )
+    {
+      header = expected;
+      return flush_top();
+    }
+    return header.magic == expected.magic && header.version == expected.version &&
+           header.little_endian == expected.little_endian &&
+           header.element_size == expected.element_size &&
+           header.element_alignment == expected.element_alignment &&
+           header.capacity == expected.capacity && header.size <= Capacity;
+  }
+
+#if defined(_WIN32)
+
+  bool Map( const std::filesystem::path& path ) noexcept
+  {
+    file_ = ::CreateFileW( path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if( file_ == INVALID_HANDLE_VALUE )
+      return false;
+    LARGE_INTEGER size;
+    if( !::GetFileSizeEx( file_, &size ) )
+      return false;
+    if( size.QuadPart != 0 && static_cast<uint64_t>( size.QuadPart ) != FileBytes )
+      return false;
+    // Mapping an empty file extends it with zeros
+    mapping_ = ::CreateFileMappingW( file_, nullptr, PAGE_READWRITE,
+                                     static_cast<DWORD>( uint64_t( FileBytes ) >> 32 ),
+                                     static_cast<DWORD>( FileBytes ), nullptr );
+    if( mapping_ == nullptr )
+      return false;
+    base_ = static_cast<std::byte*>( ::MapViewOfFile( mapping_, FILE_MAP_ALL_ACCESS, 0, 0, FileBytes ) );
+    return base_ != nullptr;
+  }
+
+  void Unmap() noexcept
+  {
+    if( base_ != nullptr )
+      ::UnmapViewOfFile( base_ );
+    if( mapping_ != nullptr )
+      ::CloseHandle( mapping_ );
+    if( file_ != INVALID_HANDLE_VALUE )
+      ::CloseHandle( file_ );
+    base_ = nullptr;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+  }
+
+  bool Sync( size_t offset, size_t bytes ) noexcept
+  {
+    return ::FlushViewOfFile( base_ + offset, bytes ) && ::FlushFileBuffers( file_ );
+  }
+
+#else
+
+  bool Map( const std::filesystem::path& path ) noexcept
+  {
+    file_ = ::open( path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644 );
+    if( file_ < 0 )
+      return false;
+    struct stat st;
+    if( ::fstat( file_, &st ) != 0 )
+      return false;
+    if( st.st_size == 0 && ::ftruncate( file_, static_cast<off_t>( FileBytes ) ) != 0 ) // zero filled
+      return false;
+    if( st.st_size != 0 && static_cast<uint64_t>( st.st_size ) != FileBytes )
+      return false;
+    auto base = ::mmap( nullptr, FileBytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0 );
+    if( base == MAP_FAILED )
+      return false;
+    base_ = static_cast<std::byte*>( base );
+    return true;
+  }
+
+  void Unmap() noexcept
+  {
+    if( base_ != nullptr )
+      ::munmap( base_, FileBytes );
+    if( file_ >= 0 )
+      ::close( file_ );
+    base_ = nullptr;
+    file_ = -1;
+  }
+
+  bool Sync( size_t offset, size_t bytes ) noexcept
+  {
+    // msync requires a page-aligned start; with pages over HeaderBytes, that includes the header
+    const auto page = static_cast<size_t>( ::sysconf( _SC_PAGESIZE ) );
+    const auto start = offset / page * page;
+    return ::msync( base_ + start, offset + bytes - start, MS_SYNC ) == 0;
+  }
+
+#endif
+
+private:
+
+  std::byte* base_ = nullptr; // the mapped file: header page, then Capacity elements
+#if defined(_WIN32)
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+
+}; // class mapped_array_stack
+
+} // namespace PKIsensee
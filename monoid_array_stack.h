@@ -0,0 +1,365 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  monoid_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  monoid_array_stack<T, Capacity, Op> is a stack of objects T that also knows the
+//  combination under Op of all its elements, e.g. their minimum, in O(1):
+//
+//    monoid_array_stack<int, 256, monoid::min<int>> window;
+//    window.push( 7 ); window.push( 3 ); window.push( 9 );
+//    window.aggregate(); // 3
+//    window.pop(); window.pop();
+//    window.aggregate(); // 7
+//
+//  Next to each element is the aggregate of it and every element below it, in a
+//  second inline array, so push() does one Op and pop() none. Op is any associative
+//  function object taking two T; monoid::min, max, sum and gcd are provided.
+//
+//  Elements can't be modified in place, which would leave the aggregates above them
+//  stale; iteration and indexing are const.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <numeric>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+namespace monoid
+{
+
+template <typename T>
+struct min
+{
+  constexpr T operator()( const T& lhs, const T& rhs ) const
+  {
+    return ( rhs < lhs ) ? rhs : lhs;
+  }
+};
+
+template <typename T>
+struct max
+{
+  constexpr T operator()( const T& lhs, const T& rhs ) const
+  {
+    return ( lhs < rhs ) ? rhs : lhs;
+  }
+};
+
+template <typename T>
+struct sum
+{
+  constexpr T operator()( const T& lhs, const T& rhs ) const
+  {
+    return lhs + rhs;
+  }
+};
+
+template <typename T>
+struct gcd
+{
+  static_assert( std::is_integral_v<T>, "monoid::gcd requires an integral type" );
+
+  constexpr T operator()( const T& lhs, const T& rhs ) const noexcept
+  {
+    return std::gcd( lhs, rhs );
+  }
+};
+
+} // namespace monoid
+
+template <typename T, size_t Capacity, // stack of objects T; maximum size Capacity
+          typename Op = monoid::min<T>> // combines two T into their aggregate
+class monoid_array_stack
+{
+public:
+
+  using value_type              = T;
+  using const_reference         = const T&;
+  using const_pointer           = const T*;
+  using const_iterator          = const_pointer;
+  using size_type               = size_t;
+  using index_type              = SmallestUnsigned<Capacity>;
+  using operation_type          = Op;
+
+  monoid_array_stack() = default;
+
+  constexpr explicit monoid_array_stack( const Op& op ) :
+    op_( op )
+  {
+  }
+
+  // Only live elements and their aggregates are copied, moved or destroyed
+  constexpr monoid_array_stack( const monoid_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> ) :
+    op_( rhs.op_ )
+  {
+    ConstructFrom<const T&>( rhs );
+  }
+
+  constexpr monoid_array_stack( monoid_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> ) :
+    op_( rhs.op_ )
+  {
+    ConstructFrom<T&&>( rhs );
+  }
+
+  constexpr monoid_array_stack& operator=( const monoid_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      op_ = rhs.op_;
+      ConstructFrom<const T&>( rhs );
+    }
+    return *this;
+  }
+
+  constexpr monoid_array_stack& operator=( monoid_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      op_ = rhs.op_;
+      ConstructFrom<T&&>( rhs );
+    }
+    return *this;
+  }
+
+  ~monoid_array_stack() requires TrivialStorage<T> = default;
+
+  constexpr ~monoid_array_stack()
+  {
+    clear();
+  }
+
+  constexpr const_iterator begin() const noexcept
+  {
+    return Data();
+  }
+
+  constexpr const_iterator end() const noexcept
+  {
+    return Data() + top_;
+  }
+
+  constexpr bool empty() const noexcept
+  {
+    return top_ == 0;
+  }
+
+  constexpr bool full() const noexcept
+  {
+    return top_ == Capacity;
+  }
+
+  constexpr size_type size() const noexcept
+  {
+    return top_;
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  constexpr void clear() noexcept
+  {
+    DestroyTop( top_ );
+  }
+
+  constexpr const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[top_ - 1];
+  }
+
+  // Op applied to all the elements, bottom to top
+  constexpr const_reference aggregate() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Aggregates()[top_ - 1];
+  }
+
+  constexpr const_reference operator[]( size_type i ) const noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[i];
+  }
+
+  constexpr void push( const value_type& v ) PK_MAY_THROW
+  {
+    emplace( v );
+  }
+
+  constexpr void push( value_type&& v ) PK_MAY_THROW
+  {
+    emplace( std::move( v ) );
+  }
+
+  template <class... Types>
+  constexpr const_reference emplace( Types&&... values ) PK_MAY_THROW
+  {
+    CheckForFullStack(1);
+    return *Construct( std::forward<Types>( values )... );
+  }
+
+  // Returns a pointer to the new element, or nullptr if the stack is full
+  template <class... Types>
+  constexpr const T* try_emplace( Types&&... values )
+  {
+    if( full() )
+      return nullptr;
+    return Construct( std::forward<Types>( values )... );
+  }
+
+  constexpr const T* try_push( const value_type& v )
+  {
+    return try_emplace( v );
+  }
+
+  constexpr void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    DestroyTop(1);
+  }
+
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack( count );
+    DestroyTop( count );
+  }
+
+  // Remove the top element and return it by value
+  constexpr value_type top_and_pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    value_type v = std::move( Data()[top_ - 1] );
+    DestroyTop(1);
+    return v;
+  }
+
+  constexpr bool operator==( const monoid_array_stack& rhs ) const noexcept
+  {
+    return std::ranges::equal( *this, rhs );
+  }
+
+private:
+
+  static_assert( Capacity <= std::numeric_limits<index_type>::max() );
+  static_assert( 2 * sizeof( InlineStorage<T, Capacity> ) <= MaxStackBytes,
+                 "monoid_array_stack exceeds PK_ARRAY_STACK_MAX_BYTES; reduce Capacity" );
+  static_assert( std::is_invocable_r_v<T, const Op&, const T&, const T&>,
+                 "Op must combine two T into a T" );
+
+  // The element, then its aggregate, which is the element itself at the bottom
+  template <class... Types>
+  constexpr const T* Construct( Types&&... values )
+  {
+    const auto p = std::construct_at( Data() + top_, std::forward<Types>( values )... );
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND) // Op may throw even if array_stack doesn't
+    try
+    {
+      ConstructAggregate( *p );
+    }
+    catch( ... )
+    {
+      std::destroy_at( p ); // leave the stack unchanged
+      throw;
+    }
+#else
+    ConstructAggregate( *p );
+#endif
+    ++top_;
+    return p;
+  }
+
+  constexpr void ConstructAggregate( const T& v )
+  {
+    if( top_ == 0 )
+      std::construct_at( Aggregates(), v );
+    else
+      std::construct_at( Aggregates() + top_, op_( Aggregates()[top_ - 1], v ) );
+  }
+
+  constexpr void DestroyTop( size_t count ) noexcept
+  {
+    if constexpr( !std::is_trivially_destructible_v<T> )
+    {
+      std::destroy( Data() + ( top_ - count ), Data() + top_ );
+      std::destroy( Aggregates() + ( top_ - count ), Aggregates() + top_ );
+    }
+    top_ = static_cast<index_type>( top_ - count );
+  }
+
+  // Construct the live elements of an empty stack from those of rhs; Source is const T&
+  // to copy them or T&& to move them. Aggregates are always copied.
+  template <typename Source, typename Rhs>
+  constexpr void ConstructFrom( Rhs& rhs )
+  {
+    for( ; top_ < rhs.top_; ++top_ )
+    {
+      std::construct_at( Data() + top_, static_cast<Source>( rhs.Data()[top_] ) );
+      std::construct_at( Aggregates() + top_, rhs.Aggregates()[top_] );
+    }
+  }
+
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, size() );
+  }
+
+  constexpr void CheckForFullStack( size_t elementsToAdd ) const
+  {
+    CheckElementsToAdd<overflow::default_>( elementsToAdd, size(), capacity() );
+  }
+
+  constexpr T* Data() noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  constexpr const T* Data() const noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  constexpr T* Aggregates() noexcept
+  {
+    return StorageData( aggregates_ );
+  }
+
+  constexpr const T* Aggregates() const noexcept
+  {
+    return StorageData( aggregates_ );
+  }
+
+private:
+
+  // c_[i] is the i-th element from the bottom and aggregates_[i] is
+  // Op( ... Op( c_[0], c_[1] ) ..., c_[i] )
+
+  index_type top_ = 0;
+  InlineStorage<T, Capacity> c_;
+  InlineStorage<T, Capacity> aggregates_;
+  PK_NO_UNIQUE_ADDRESS Op op_;
+
+}; // class monoid_array_stack
+
+} // namespace PKIsensee
@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  ring_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  ring_array_stack<T, Capacity> is a bounded stack that never overflows: pushing
+//  to a full stack overwrites the oldest element, the one at the bottom. It's the
+//  natural container for undo history, recent-item lists and trace buffers:
+//
+//    ring_array_stack<Edit, 100> undo;
+//    undo.push( edit );          // once full, forgets the oldest edit
+//    if( !undo.empty() ) { Revert( undo.top() ); undo.pop(); }
+//
+//  Elements are stored inline in a circular buffer, so every push and pop is O(1).
+//  Iteration runs from the oldest element to the newest, like array_stack's bottom
+//  to top; top_down() runs from the newest. Iterators are random access but not
+//  contiguous, which is why array_stack itself offers overflow::drop_new instead.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity> // stack of objects T; maximum size Capacity
+class ring_array_stack
+{
+  static_assert( Capacity > 0, "ring_array_stack requires a non-zero Capacity" );
+  static_assert( sizeof( InlineStorage<T, Capacity> ) <= MaxStackBytes,
+                 "ring_array_stack exceeds PK_ARRAY_STACK_MAX_BYTES; reduce Capacity" );
+
+  // Iterates over the live elements of a ring, oldest first; Elem is T or const T
+  template <typename Elem>
+  class Iterator
+  {
+  public:
+
+    using iterator_concept  = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type        = std::remove_const_t<Elem>;
+    using difference_type   = ptrdiff_t;
+    using pointer           = Elem*;
+    using reference         = Elem&;
+
+    Iterator() = default;
+
+    constexpr Iterator( Elem* data, size_t head, size_t i ) noexcept :
+      data_( data ),
+      head_( head ),
+      i_( i )
+    {
+    }
+
+    // iterator converts to const_iterator
+    constexpr operator Iterator<const Elem>() const noexcept requires( !std::is_const_v<Elem> )
+    {
+      return { data_, head_, i_ };
+    }
+
+    constexpr reference operator*() const noexcept
+    {
+      return data_[ Slot( head_, i_ ) ];
+    }
+
+    constexpr pointer operator->() const noexcept
+    {
+      return &**this;
+    }
+
+    constexpr reference operator[]( difference_type n ) const noexcept
+    {
+      return *( *this + n );
+    }
+
+    constexpr Iterator& operator++() noexcept
+    {
+      ++i_;
+      return *this;
+    }
+
+    constexpr Iterator operator++( int ) noexcept
+    {
+      auto it = *this;
+      ++i_;
+      return it;
+    }
+
+    constexpr Iterator& operator--() noexcept
+    {
+      --i_;
+      return *this;
+    }
+
+    constexpr Iterator operator--( int ) noexcept
+    {
+      auto it = *this;
+      --i_;
+      return it;
+    }
+
+    constexpr Iterator& operator+=( difference_type n ) noexcept
+    {
+      i_ = static_cast<size_t>( static_cast<difference_type>( i_ ) + n );
+      return *this;
+    }
+
+    constexpr Iterator& operator-=( difference_type n ) noexcept
+    {
+      return *this += -n;
+    }
+
+    friend constexpr Iterator operator+( Iterator it, difference_type n ) noexcept
+    {
+      return it += n;
+    }
+
+    friend constexpr Iterator operator+( difference_type n, Iterator it ) noexcept
+    {
+      return it += n;
+    }
+
+    friend constexpr Iterator operator-( Iterator it, difference_type n ) noexcept
+    {
+      return it -= n;
+    }
+
+    friend constexpr difference_type operator-( const Iterator& lhs, const Iterator& rhs ) noexcept
+    {
+      return static_cast<difference_type>( lhs.i_ ) - static_cast<difference_type>( rhs.i_ );
+    }
+
+    friend constexpr bool operator==( const Iterator& lhs, const Iterator& rhs ) noexcept
+    {
+      return lhs.i_ == rhs.i_;
+    }
+
+    friend constexpr auto operator<=>( const Iterator& lhs, const Iterator& rhs ) noexcept
+    {
+      return lhs.i_ <=> rhs.i_;
+    }
+
+  private:
+
+    Elem* data_ = nullptr;
+    size_t head_ = 0; // slot of the oldest element
+    size_t i_ = 0;    // position from the oldest element
+
+  }; // class Iterator
+
+public:
+
+  using value_type              = T;
+  using reference               = T&;
+  using const_reference         = const T&;
+  using pointer                 = T*;
+  using const_pointer           = const T*;
+  using iterator                = Iterator<T>;
+  using const_iterator          = Iterator<const T>;
+  using reverse_iterator        = std::reverse_iterator<iterator>;
+  using const_reverse_iterator  = std::reverse_iterator<const_iterator>;
+  using size_type               = size_t;
+  using index_type              = SmallestUnsigned<Capacity>;
+
+  ring_array_stack() = default;
+
+  // Copies and moves store the live elements oldest first from the start of the buffer
+  constexpr ring_array_stack( const ring_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    for( const auto& v : rhs )
+      std::construct_at( Data() + top_++, v );
+  }
+
+  constexpr ring_array_stack( ring_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    for( auto& v : rhs )
+      std::construct_at( Data() + top_++, std::move( v ) );
+  }
+
+  constexpr ring_array_stack& operator=( const ring_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      for( const auto& v : rhs )
+        std::construct_at( Data() + top_++, v );
+    }
+    return *this;
+  }
+
+  constexpr ring_array_stack& operator=( ring_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      for( auto& v : rhs )
+        std::construct_at( Data() + top_++, std::move( v ) );
+    }
+    return *this;
+  }
+
+  ~ring_array_stack() requires TrivialStorage<T> = default;
+
+  constexpr ~ring_array_stack()
+  {
+    clear();
+  }
+
+  constexpr iterator begin() noexcept
+  {
+    return { Data(), head_, 0 };
+  }
+
+  constexpr const_iterator begin() const noexcept
+  {
+    return { Data(), head_, 0 };
+  }
+
+  constexpr const_iterator cbegin() const noexcept
+  {
+    return begin();
+  }
+
+  constexpr iterator end() noexcept
+  {
+    return { Data(), head_, top_ };
+  }
+
+  constexpr const_iterator end() const noexcept
+  {
+    return { Data(), head_, top_ };
+  }
+
+  constexpr const_iterator cend() const noexcept
+  {
+    return end();
+  }
+
+  constexpr reverse_iterator rbegin() noexcept
+  {
+    return reverse_iterator( end() );
+  }
+
+  constexpr const_reverse_iterator rbegin() const noexcept
+  {
+    return const_reverse_iterator( end() );
+  }
+
+  constexpr const_reverse_iterator crbegin() const noexcept
+  {
+    return rbegin();
+  }
+
+  constexpr reverse_iterator rend() noexcept
+  {
+    return reverse_iterator( begin() );
+  }
+
+  constexpr const_reverse_iterator rend() const noexcept
+  {
+    return const_reverse_iterator( begin() );
+  }
+
+  constexpr const_reverse_iterator crend() const noexcept
+  {
+    return rend();
+  }
+
+  // Live elements from the newest down to the oldest
+  constexpr std::ranges::subrange<reverse_iterator> top_down() noexcept
+  {
+    return { rbegin(), rend() };
+  }
+
+  constexpr std::ranges::subrange<const_reverse_iterator> top_down() const noexcept
+  {
+    return { rbegin(), rend() };
+  }
+
+  constexpr bool empty() const noexcept
+  {
+    return top_ == 0;
+  }
+
+  constexpr bool full() const noexcept
+  {
+    return top_ == Capacity;
+  }
+
+  constexpr size_type size() const noexcept
+  {
+    return top_;
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  constexpr void clear() noexcept
+  {
+    std::destroy( begin(), end() );
+    head_ = 0;
+    top_ = 0;
+  }
+
+  // Newest element
+  constexpr reference top() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[ Slot( head_, top_ - 1u ) ];
+  }
+
+  constexpr const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[ Slot( head_, top_ - 1u ) ];
+  }
+
+  // Oldest element, the next to be overwritten
+  constexpr reference bottom() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[ head_ ];
+  }
+
+  constexpr const_reference bottom() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Data()[ head_ ];
+  }
+
+  constexpr void push( const value_type& v )
+    noexcept( std::is_nothrow_copy_constructible_v<T> && std::is_nothrow_move_constructible_v<T> )
+  {
+    emplace( v );
+  }
+
+  constexpr void push( value_type&& v )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    emplace( std::move( v ) );
+  }
+
+  template <typename Range>
+  constexpr void push_range( Range&& rng )
+  {
+    for( auto&& v : rng )
+      emplace( std::forward<decltype( v )>( v ) );
+  }
+
+  // If the stack is full, the oldest element is replaced and its slot reused. The new
+  // element is built first, since values may refer to the oldest, e.g. push( bottom() ),
+  // and the stack is unchanged if building it throws.
+  template <class... Types>
+  constexpr reference emplace( Types&&... values )
+    noexcept( std::is_nothrow_constructible_v<T, Types...> && std::is_nothrow_move_constructible_v<T> )
+  {
+    if( full() )
+    {
+      T value( std::forward<Types>( values )... );
+      auto* slot = Data() + head_;
+      if constexpr( std::is_nothrow_move_constructible_v<T> )
+      {
+        std::destroy_at( slot );
+        std::construct_at( slot, std::move( value ) );
+      }
+      else // a throwing move would leave a destroyed slot
+      {
+        *slot = std::move( value );
+      }
+      head_ = static_cast<index_type>( Slot( head_, 1 ) );
+      return *slot;
+    }
+    auto* slot = Data() + Slot( head_, top_ );
+    std::construct_at( slot, std::forward<Types>( values )... );
+    ++top_;
+    return *slot;
+  }
+
+  // Remove the newest element
+  constexpr void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    std::destroy_at( Data() + Slot( head_, top_ - 1u ) );
+    --top_;
+  }
+
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack( count );
+    std::destroy( end() - static_cast<ptrdiff_t>( count ), end() );
+    top_ = static_cast<index_type>( top_ - count );
+  }
+
+  // Remove the newest element and return it by value
+  constexpr value_type top_and_pop() PK_MAY_THROW
+  {
+    value_type v = std::move( top() );
+    pop();
+    return v;
+  }
+
+  // Element i, where 0 is the oldest
+  constexpr reference operator[]( size_type i ) noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[ Slot( head_, i ) ];
+  }
+
+  constexpr const_reference operator[]( size_type i ) const noexcept
+  {
+    PK_ASSERT( i < size() );
+    return Data()[ Slot( head_, i ) ];
+  }
+
+  constexpr bool operator==( const ring_array_stack& rhs ) const noexcept
+  {
+    return std::ranges::equal( *this, rhs );
+  }
+
+  constexpr auto operator<=>( const ring_array_stack& rhs ) const noexcept
+  {
+    return std::lexicographical_compare_three_way( begin(), end(), rhs.begin(), rhs.end(),
+                                                   SynthThreeWay{} );
+  }
+
+private:
+
+  // Buffer slot of the element i positions after the one at slot head
+  static constexpr size_t Slot( size_t head, size_t i ) noexcept
+  {
+    const auto slot = head + i;
+    return ( slot < Capacity ) ? slot : slot - Capacity;
+  }
+
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, size() );
+  }
+
+  constexpr T* Data() noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  constexpr const T* Data() const noexcept
+  {
+    return StorageData( c_ );
+  }
+
+private:
+
+  // head_ is the slot of the oldest element; top_ is the number of live elements,
+  // which occupy slots head_, head_ + 1, ... wrapping around at Capacity
+
+  index_type head_ = 0;
+  index_type top_ = 0;
+  InlineStorage<T, Capacity> c_;
+
+}; // class ring_array_stack
+
+template <typename T, size_t Capacity>
+constexpr void swap( ring_array_stack<T, Capacity>& lhs, ring_array_stack<T, Capacity>& rhs )
+  noexcept( std::is_nothrow_move_constructible_v<T> )
+{
+  auto tmp = std::move( lhs );
+  lhs = std::move( rhs );
+  rhs = std::move( tmp );
+}
+
+} // namespace PKIsensee
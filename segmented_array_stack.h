@@ -0,0 +1,408 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  segmented_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  segmented_array_stack<T, Capacity, K> is K stacks of objects T sharing one
+//  inline array of Capacity elements. Each stack owns a segment of the array and
+//  the free slots after it; when a stack outgrows its segment, the segments are
+//  repacked so that every stack gets a share of the free slots, and the largest
+//  stacks the largest shares. The stacks only overflow when their combined size
+//  exceeds Capacity:
+//
+//    segmented_array_stack<Symbol, 4096, 3> parser; // values, states, locations
+//    parser.push<0>( value );
+//    parser.push<1>( state );
+//    parser.pop<2>();
+//
+//  Each stack has the array_stack operations, indexed by I. push() is O(1) except
+//  when it repacks, which moves up to size() elements; as with std::vector,
+//  pushing to any stack may move the elements of the others, invalidating
+//  references to them. See twin_array_stack.h for two stacks, which never move.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <span>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity, size_t K> // K stacks of objects T; maximum combined size Capacity
+class segmented_array_stack
+{
+  static_assert( K > 0, "segmented_array_stack requires at least one stack" );
+
+public:
+
+  using value_type              = T;
+  using reference               = T&;
+  using const_reference         = const T&;
+  using size_type               = size_t;
+  using index_type              = SmallestUnsigned<Capacity>;
+
+  // Segments start out equally sized
+  constexpr segmented_array_stack() noexcept
+  {
+    for( size_t i = 0; i < K; ++i )
+      base_[i] = static_cast<index_type>( i * Capacity / K );
+  }
+
+  // Only live elements are copied, moved or destroyed; the segments keep their layout
+  constexpr segmented_array_stack( const segmented_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    ConstructFrom<const T&>( rhs );
+  }
+
+  constexpr segmented_array_stack( segmented_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    ConstructFrom<T&&>( rhs );
+  }
+
+  constexpr segmented_array_stack& operator=( const segmented_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      ConstructFrom<const T&>( rhs );
+    }
+    return *this;
+  }
+
+  constexpr segmented_array_stack& operator=( segmented_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      ConstructFrom<T&&>( rhs );
+    }
+    return *this;
+  }
+
+  ~segmented_array_stack() requires TrivialStorage<T> = default;
+
+  constexpr ~segmented_array_stack()
+  {
+    clear();
+  }
+
+  static constexpr size_type stack_count() noexcept
+  {
+    return K;
+  }
+
+  template <size_t I>
+  constexpr bool empty() const noexcept
+  {
+    return Count<I>() == 0;
+  }
+
+  // There is one array, so every stack is full at once
+  constexpr bool full() const noexcept
+  {
+    return size() == Capacity;
+  }
+
+  template <size_t I>
+  constexpr size_type size() const noexcept
+  {
+    return Count<I>();
+  }
+
+  // Combined size of all the stacks
+  constexpr size_type size() const noexcept
+  {
+    size_type total = 0;
+    for( auto count : size_ )
+      total += count;
+    return total;
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  template <size_t I>
+  constexpr void clear() noexcept
+  {
+    DestroyTop( I, Count<I>() );
+  }
+
+  constexpr void clear() noexcept
+  {
+    for( size_t i = 0; i < K; ++i )
+      DestroyTop( i, size_[i] );
+  }
+
+  template <size_t I>
+  constexpr reference top() PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    return Data()[ base_[I] + size_[I] - 1u ];
+  }
+
+  template <size_t I>
+  constexpr const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    return Data()[ base_[I] + size_[I] - 1u ];
+  }
+
+  template <size_t I>
+  constexpr void push( const value_type& v ) PK_MAY_THROW
+  {
+    emplace<I>( v );
+  }
+
+  template <size_t I>
+  constexpr void push( value_type&& v ) PK_MAY_THROW
+  {
+    emplace<I>( std::move( v ) );
+  }
+
+  template <size_t I, class... Types>
+  constexpr reference emplace( Types&&... values ) PK_MAY_THROW
+  {
+    CheckForFullStack(1);
+    return *Construct<I>( std::forward<Types>( values )... );
+  }
+
+  // Returns a pointer to the new element, or nullptr if the array is full
+  template <size_t I, class... Types>
+  constexpr T* try_emplace( Types&&... values )
+    noexcept( std::is_nothrow_constructible_v<T, Types...> && std::is_nothrow_move_constructible_v<T> )
+  {
+    if( full() )
+      return nullptr;
+    return Construct<I>( std::forward<Types>( values )... );
+  }
+
+  template <size_t I>
+  constexpr T* try_push( const value_type& v )
+    noexcept( std::is_nothrow_copy_constructible_v<T> && std::is_nothrow_move_constructible_v<T> )
+  {
+    return try_emplace<I>( v );
+  }
+
+  template <size_t I>
+  constexpr void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    DestroyTop( I, 1 );
+  }
+
+  template <size_t I>
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>( count );
+    DestroyTop( I, count );
+  }
+
+  // Remove the top element of stack I and return it by value
+  template <size_t I>
+  constexpr value_type top_and_pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    value_type v = std::move( Data()[ base_[I] + size_[I] - 1u ] );
+    DestroyTop( I, 1 );
+    return v;
+  }
+
+  // Live elements of stack I from its bottom to its top
+  template <size_t I>
+  constexpr std::span<T> elements() noexcept
+  {
+    return { Data() + base_[I], Count<I>() };
+  }
+
+  template <size_t I>
+  constexpr std::span<const T> elements() const noexcept
+  {
+    return { Data() + base_[I], Count<I>() };
+  }
+
+  constexpr bool operator==( const segmented_array_stack& rhs ) const noexcept
+  {
+    for( size_t i = 0; i < K; ++i )
+      if( !std::ranges::equal( std::span( Data() + base_[i], size_[i] ),
+                               std::span( rhs.Data() + rhs.base_[i], rhs.size_[i] ) ) )
+        return false;
+    return true;
+  }
+
+private:
+
+  static_assert( Capacity <= std::numeric_limits<index_type>::max() );
+  static_assert( sizeof( InlineStorage<T, Capacity> ) <= MaxStackBytes,
+                 "segmented_array_stack exceeds PK_ARRAY_STACK_MAX_BYTES; reduce Capacity" );
+
+  template <size_t I>
+  constexpr size_t Count() const noexcept
+  {
+    static_assert( I < K, "stack index out of range" );
+    return size_[I];
+  }
+
+  // One past the last slot stack i may use without repacking
+  constexpr size_t Limit( size_t i ) const noexcept
+  {
+    return ( i + 1 < K ) ? base_[i + 1] : Capacity;
+  }
+
+  template <size_t I, class... Types>
+  constexpr T* Construct( Types&&... values )
+  {
+    static_assert( I < K, "stack index out of range" );
+    if( base_[I] + size_[I] == Limit( I ) )
+    {
+      // The arguments may refer to elements that repacking moves
+      value_type v( std::forward<Types>( values )... );
+      Repack( I );
+      const auto p = std::construct_at( Data() + base_[I] + size_[I], std::move( v ) );
+      ++size_[I];
+      return p;
+    }
+    const auto p = std::construct_at( Data() + base_[I] + size_[I], std::forward<Types>( values )... );
+    ++size_[I];
+    return p;
+  }
+
+  constexpr void DestroyTop( size_t i, size_t count ) noexcept
+  {
+    const auto top = Data() + base_[i] + size_[i];
+    if constexpr( !std::is_trivially_destructible_v<T> )
+      std::destroy( top - count, top );
+    size_[i] = static_cast<index_type>( size_[i] - count );
+  }
+
+  // Lay the segments out again so that stack grow has at least one free slot. Free slots
+  // go to each stack in proportion to its size plus one, and the remainder to grow.
+  constexpr void Repack( size_t grow )
+  {
+    const auto used = size();
+    const auto free = Capacity - used;
+    PK_ASSERT( free > 0 );
+    size_t share[K];
+    size_t given = 0;
+    for( size_t i = 0; i < K; ++i )
+    {
+      share[i] = ( free - 1 ) * ( size_[i] + 1u ) / ( used + K );
+      given += share[i];
+    }
+    share[grow] += free - given; // at least one
+    index_type base[K];
+    size_t next = 0;
+    for( size_t i = 0; i < K; ++i )
+    {
+      base[i] = static_cast<index_type>( next );
+      next += size_[i] + share[i];
+    }
+
+    // Segments moving down are moved in order from the bottom, and segments moving up
+    // in order from the top, so that no segment lands on one that hasn't moved yet
+    for( size_t i = 0; i < K; ++i )
+      if( base[i] < base_[i] )
+        MoveSegment( i, base[i] );
+    for( size_t i = K; i-- > 0; )
+      if( base[i] > base_[i] )
+        MoveSegment( i, base[i] );
+  }
+
+  // Move the elements of stack i so that it starts at slot base
+  constexpr void MoveSegment( size_t i, index_type base )
+  {
+    const auto from = Data() + base_[i];
+    const auto to = Data() + base;
+    const size_t count = size_[i];
+    base_[i] = base;
+    if constexpr( std::is_trivially_copyable_v<T> )
+    {
+      if( !std::is_constant_evaluated() )
+      {
+        if( count > 0 )
+          std::memmove( to, from, count * sizeof( T ) );
+        return;
+      }
+    }
+    // Elements are moved in the order that never overwrites one not yet moved
+    if( to < from )
+    {
+      for( size_t k = 0; k < count; ++k )
+      {
+        std::construct_at( to + k, std::move( from[k] ) );
+        std::destroy_at( from + k );
+      }
+    }
+    else
+    {
+      for( size_t k = count; k-- > 0; )
+      {
+        std::construct_at( to + k, std::move( from[k] ) );
+        std::destroy_at( from + k );
+      }
+    }
+  }
+
+  // Construct the live elements of an empty stack from those of rhs, in the same slots;
+  // Source is const T& to copy them or T&& to move them
+  template <typename Source, typename Rhs>
+  constexpr void ConstructFrom( Rhs& rhs )
+  {
+    for( size_t i = 0; i < K; ++i )
+    {
+      base_[i] = rhs.base_[i];
+      for( ; size_[i] < rhs.size_[i]; ++size_[i] )
+        std::construct_at( Data() + base_[i] + size_[i], static_cast<Source>( rhs.Data()[base_[i] + size_[i]] ) );
+    }
+  }
+
+  template <size_t I>
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, Count<I>() );
+  }
+
+  constexpr void CheckForFullStack( size_t elementsToAdd ) const
+  {
+    CheckElementsToAdd<overflow::default_>( elementsToAdd, size(), capacity() );
+  }
+
+  constexpr T* Data() noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  constexpr const T* Data() const noexcept
+  {
+    return StorageData( c_ );
+  }
+
+private:
+
+  // Stack i occupies c_[base_[i], base_[i] + size_[i]), followed by its free slots up to
+  // base_[i+1]; the segments are in order and base_[0] is always 0 after a repack
+
+  index_type base_[K] = {};
+  index_type size_[K] = {};
+  InlineStorage<T, Capacity> c_;
+
+}; // class segmented_array_stack
+
+} // namespace PKIsensee
@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  soa_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  soa_array_stack<Capacity, Fields...> is an array_stack of records whose fields
+//  are stored structure-of-arrays style: each field in its own inline array of
+//  Capacity elements, all sharing a single element count.
+//
+//  A scan over one field touches only that field's array, e.g.
+//
+//    soa_array_stack<1024, uint32_t, float, uint16_t> frames; // node, cost, depth
+//    frames.push( node, cost, depth );
+//    for( float cost : frames.column<1>() ) ...
+//    if( frames.contains<0>( node ) ) ...
+//
+//  and contains<I>() and find_from_top<I>() use the same vectorized kernels as
+//  array_stack for arithmetic fields.
+//
+//  Records are split across columns, so fields must be trivially copyable.
+//
+//  Pushing to a full stack follows the default overflow policy of array_stack;
+//  basic_soa_array_stack<Overflow, Capacity, Fields...> takes any other, e.g.
+//  overflow::drop_new.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <span>
+#include <tuple>
+#include "array_stack.h"
+
+namespace // anonymous
+{
+
+// One column of a soa_array_stack; I distinguishes columns of the same type
+template <size_t I, typename T, size_t N>
+struct SoaColumn
+{
+  InlineStorage<T, N> storage_;
+};
+
+template <typename Indices, size_t N, typename... Fields>
+struct SoaColumns;
+
+template <size_t... Is, size_t N, typename... Fields>
+struct SoaColumns<std::index_sequence<Is...>, N, Fields...> : SoaColumn<Is, Fields, N>...
+{
+};
+
+}; // namespace anonymous
+
+namespace PKIsensee
+{
+
+template <typename Overflow,                   // one of the overflow policies
+          size_t Capacity, typename... Fields> // stack of records { Fields... }; maximum size Capacity
+class basic_soa_array_stack
+{
+  static_assert( sizeof...( Fields ) > 0, "soa_array_stack requires at least one field" );
+  static_assert( ( std::is_trivially_copyable_v<Fields> && ... ), "Fields must be trivially copyable" );
+
+public:
+
+  using value_type              = std::tuple<Fields...>;
+  using reference               = std::tuple<Fields&...>;
+  using const_reference         = std::tuple<const Fields&...>;
+  using size_type               = size_t;
+  using index_type              = SmallestUnsigned<Capacity>;
+
+  template <size_t I>
+  using field_type              = std::tuple_element_t<I, value_type>;
+
+  basic_soa_array_stack() = default;
+
+  // Only live records are copied
+  constexpr basic_soa_array_stack( const basic_soa_array_stack& rhs ) noexcept :
+    top_( rhs.top_ )
+  {
+    CopyColumns( rhs, FieldIndices{} );
+  }
+
+  constexpr basic_soa_array_stack& operator=( const basic_soa_array_stack& rhs ) noexcept
+  {
+    if( this != &rhs )
+    {
+      top_ = rhs.top_;
+      CopyColumns( rhs, FieldIndices{} );
+    }
+    return *this;
+  }
+
+  constexpr bool empty() const noexcept
+  {
+    return top_ == 0;
+  }
+
+  constexpr bool full() const noexcept
+  {
+    return top_ == Capacity;
+  }
+
+  constexpr size_type size() const noexcept
+  {
+    return top_;
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  constexpr void clear() noexcept
+  {
+    top_ = 0;
+  }
+
+  constexpr reference top() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Row( top_ - 1u, FieldIndices{} );
+  }
+
+  constexpr const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Row( top_ - 1u, FieldIndices{} );
+  }
+
+  template <size_t I>
+  constexpr field_type<I>& top() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Column<I>()[top_ - 1u];
+  }
+
+  template <size_t I>
+  constexpr const field_type<I>& top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    return Column<I>()[top_ - 1u];
+  }
+
+  constexpr void push( const Fields&... fields ) noexcept( NothrowOverflow<Overflow> )
+  {
+    if( CheckForFullStack(1) == 0 ) // dropped
+      return;
+    Store( FieldIndices{}, fields... );
+    ++top_;
+  }
+
+  constexpr void push( const value_type& record ) noexcept( NothrowOverflow<Overflow> )
+  {
+    std::apply( [this]( const Fields&... fields ) { push( fields... ); }, record );
+  }
+
+  // Returns false, leaving the stack unchanged, if the stack is full
+  constexpr bool try_push( const Fields&... fields ) noexcept
+  {
+    if( full() )
+      return false;
+    Store( FieldIndices{}, fields... );
+    ++top_;
+    return true;
+  }
+
+  constexpr void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack(1);
+    --top_;
+  }
+
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack( count );
+    top_ = static_cast<index_type>( top_ - count );
+  }
+
+  // Field I of the live records, from the bottom of the stack to the top
+  template <size_t I>
+  constexpr std::span<field_type<I>> column() noexcept
+  {
+    return { Column<I>(), top_ };
+  }
+
+  template <size_t I>
+  constexpr std::span<const field_type<I>> column() const noexcept
+  {
+    return { Column<I>(), top_ };
+  }
+
+  template <size_t I>
+  constexpr bool contains( const field_type<I>& v ) const noexcept
+  {
+    return FindFirst( Column<I>(), top_, v ) != top_;
+  }
+
+  // Index of the topmost record whose field I equals v, or size() if there is none
+  template <size_t I>
+  constexpr size_type find_from_top( const field_type<I>& v ) const noexcept
+  {
+    return FindLast( Column<I>(), top_, v );
+  }
+
+private:
+
+  using FieldIndices = std::index_sequence_for<Fields...>;
+
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, size() );
+  }
+
+  // Applies the overflow policy; returns how many of elementsToAdd to push
+  constexpr size_t CheckForFullStack( size_t elementsToAdd ) const noexcept( NothrowOverflow<Overflow> )
+  {
+    return CheckElementsToAdd<Overflow>( elementsToAdd, size(), capacity() );
+  }
+
+  template <size_t I>
+  constexpr field_type<I>* Column() noexcept
+  {
+    return StorageData( static_cast<SoaColumn<I, field_type<I>, Capacity>&>( columns_ ).storage_ );
+  }
+
+  template <size_t I>
+  constexpr const field_type<I>* Column() const noexcept
+  {
+    return StorageData( static_cast<const SoaColumn<I, field_type<I>, Capacity>&>( columns_ ).storage_ );
+  }
+
+  template <size_t... Is>
+  constexpr reference Row( size_t i, std::index_sequence<Is...> ) noexcept
+  {
+    return { Column<Is>()[i]... };
+  }
+
+  template <size_t... Is>
+  constexpr const_reference Row( size_t i, std::index_sequence<Is...> ) const noexcept
+  {
+    return { Column<Is>()[i]... };
+  }
+
+  // Construct the fields of a new record at top_
+  template <size_t... Is>
+  constexpr void Store( std::index_sequence<Is...>, const Fields&... fields ) noexcept
+  {
+    ( std::construct_at( Column<Is>() + top_, fields ), ... );
+  }
+
+  // Copy the first top_ elements of each column of rhs
+  template <size_t... Is>
+  constexpr void CopyColumns( const basic_soa_array_stack& rhs, std::index_sequence<Is...> ) noexcept
+  {
+    ( CopyColumn( Column<Is>(), rhs.template Column<Is>() ), ... );
+  }
+
+  template <typename F>
+  constexpr void CopyColumn( F* dest, const F* src ) const noexcept
+  {
+    if( !std::is_constant_evaluated() )
+    {
+      if( top_ != 0 )
+        std::memcpy( dest, src, top_ * sizeof( F ) );
+      return;
+    }
+    for( size_t i = 0; i < top_; ++i )
+      std::construct_at( dest + i, src[i] );
+  }
+
+private:
+
+  // top_ is shared by every column and points to where the *next* record will be pushed
+
+  index_type top_ = 0;
+  SoaColumns<FieldIndices, Capacity, Fields...> columns_;
+
+}; // class basic_soa_array_stack
+
+template <size_t Capacity, typename... Fields>
+using soa_array_stack = basic_soa_array_stack<overflow::default_, Capacity, Fields...>;
+
+} // namespace PKIsensee
@@ -0,0 +1,348 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  twin_array_stack.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  twin_array_stack<T, Capacity> is two stacks of objects T sharing one inline
+//  array of Capacity elements. Stack 0 grows up from the start of the array and
+//  stack 1 grows down from the end, so either can use whatever the other doesn't,
+//  and the pair only overflows when their combined size exceeds Capacity:
+//
+//    twin_array_stack<Value, 1024> s; // operands and saved operands
+//    s.push<0>( v );
+//    s.push<1>( s.top<0>() );
+//    s.pop<0>();
+//
+//  Each stack has the array_stack operations, indexed by I. For sizing, the
+//  footprint is the peak of the combined size rather than the sum of the peaks.
+//  See segmented_array_stack.h for more than two stacks.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <span>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity> // two stacks of objects T; maximum combined size Capacity
+class twin_array_stack
+{
+public:
+
+  using value_type              = T;
+  using reference               = T&;
+  using const_reference         = const T&;
+  using size_type               = size_t;
+  using index_type              = SmallestUnsigned<Capacity>;
+
+  twin_array_stack() = default;
+
+  // Only live elements are copied, moved or destroyed
+  constexpr twin_array_stack( const twin_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    ConstructFrom<const T&>( rhs );
+  }
+
+  constexpr twin_array_stack( twin_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    ConstructFrom<T&&>( rhs );
+  }
+
+  constexpr twin_array_stack& operator=( const twin_array_stack& rhs )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      ConstructFrom<const T&>( rhs );
+    }
+    return *this;
+  }
+
+  constexpr twin_array_stack& operator=( twin_array_stack&& rhs )
+    noexcept( std::is_nothrow_move_constructible_v<T> )
+  {
+    if( this != &rhs )
+    {
+      clear();
+      ConstructFrom<T&&>( rhs );
+    }
+    return *this;
+  }
+
+  ~twin_array_stack() requires TrivialStorage<T> = default;
+
+  constexpr ~twin_array_stack()
+  {
+    clear();
+  }
+
+  template <size_t I>
+  constexpr bool empty() const noexcept
+  {
+    return Count<I>() == 0;
+  }
+
+  // There is one array, so both stacks are full at once
+  constexpr bool full() const noexcept
+  {
+    return lo_ + hi_ == Capacity;
+  }
+
+  template <size_t I>
+  constexpr size_type size() const noexcept
+  {
+    return Count<I>();
+  }
+
+  // Combined size of both stacks
+  constexpr size_type size() const noexcept
+  {
+    return lo_ + hi_;
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  template <size_t I>
+  constexpr void clear() noexcept
+  {
+    DestroyTop<I>( Count<I>() );
+  }
+
+  constexpr void clear() noexcept
+  {
+    clear<0>();
+    clear<1>();
+  }
+
+  template <size_t I>
+  constexpr reference top() PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    return Data()[ TopSlot<I>() ];
+  }
+
+  template <size_t I>
+  constexpr const_reference top() const PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    return Data()[ TopSlot<I>() ];
+  }
+
+  template <size_t I>
+  constexpr void push( const value_type& v ) PK_MAY_THROW
+  {
+    emplace<I>( v );
+  }
+
+  template <size_t I>
+  constexpr void push( value_type&& v ) PK_MAY_THROW
+  {
+    emplace<I>( std::move( v ) );
+  }
+
+  template <size_t I, class... Types>
+  constexpr reference emplace( Types&&... values ) PK_MAY_THROW
+  {
+    CheckForFullStack(1);
+    return *Construct<I>( std::forward<Types>( values )... );
+  }
+
+  // Returns a pointer to the new element, or nullptr if the array is full
+  template <size_t I, class... Types>
+  constexpr T* try_emplace( Types&&... values )
+    noexcept( std::is_nothrow_constructible_v<T, Types...> )
+  {
+    if( full() )
+      return nullptr;
+    return Construct<I>( std::forward<Types>( values )... );
+  }
+
+  template <size_t I>
+  constexpr T* try_push( const value_type& v )
+    noexcept( std::is_nothrow_copy_constructible_v<T> )
+  {
+    return try_emplace<I>( v );
+  }
+
+  template <size_t I>
+  constexpr void pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    DestroyTop<I>(1);
+  }
+
+  template <size_t I>
+  constexpr void pop_n( size_type count ) PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>( count );
+    DestroyTop<I>( count );
+  }
+
+  // Remove the top element of stack I and return it by value
+  template <size_t I>
+  constexpr value_type top_and_pop() PK_MAY_THROW
+  {
+    CheckForEmptyStack<I>(1);
+    value_type v = std::move( Data()[ TopSlot<I>() ] );
+    DestroyTop<I>(1);
+    return v;
+  }
+
+  // Live elements of stack I from its bottom to its top
+  template <size_t I>
+  constexpr auto elements() noexcept
+  {
+    return Elements<I>( *this );
+  }
+
+  template <size_t I>
+  constexpr auto elements() const noexcept
+  {
+    return Elements<I>( *this );
+  }
+
+  constexpr bool operator==( const twin_array_stack& rhs ) const noexcept
+  {
+    return std::ranges::equal( elements<0>(), rhs.elements<0>() ) &&
+           std::ranges::equal( elements<1>(), rhs.elements<1>() );
+  }
+
+private:
+
+  static_assert( Capacity <= std::numeric_limits<index_type>::max() );
+  static_assert( sizeof( InlineStorage<T, Capacity> ) <= MaxStackBytes,
+                 "twin_array_stack exceeds PK_ARRAY_STACK_MAX_BYTES; reduce Capacity" );
+
+  template <size_t I>
+  static constexpr void CheckIndex() noexcept
+  {
+    static_assert( I < 2, "twin_array_stack has stacks 0 and 1" );
+  }
+
+  template <size_t I>
+  constexpr size_t Count() const noexcept
+  {
+    CheckIndex<I>();
+    return ( I == 0 ) ? lo_ : hi_;
+  }
+
+  // Slot of the top element of stack I
+  template <size_t I>
+  constexpr size_t TopSlot() const noexcept
+  {
+    return ( I == 0 ) ? lo_ - 1u : Capacity - hi_;
+  }
+
+  template <size_t I, class... Types>
+  constexpr T* Construct( Types&&... values )
+  {
+    CheckIndex<I>();
+    if constexpr( I == 0 )
+    {
+      const auto p = std::construct_at( Data() + lo_, std::forward<Types>( values )... );
+      ++lo_;
+      return p;
+    }
+    else
+    {
+      const auto p = std::construct_at( Data() + ( Capacity - hi_ - 1u ), std::forward<Types>( values )... );
+      ++hi_;
+      return p;
+    }
+  }
+
+  template <size_t I>
+  constexpr void DestroyTop( size_t count ) noexcept
+  {
+    CheckIndex<I>();
+    if constexpr( I == 0 )
+    {
+      if constexpr( !std::is_trivially_destructible_v<T> )
+        std::destroy( Data() + ( lo_ - count ), Data() + lo_ );
+      lo_ = static_cast<index_type>( lo_ - count );
+    }
+    else
+    {
+      if constexpr( !std::is_trivially_destructible_v<T> )
+        std::destroy( Data() + ( Capacity - hi_ ), Data() + ( Capacity - hi_ + count ) );
+      hi_ = static_cast<index_type>( hi_ - count );
+    }
+  }
+
+  // Stack 1 is stored top first, so its elements are seen in reverse
+  template <size_t I, typename Self>
+  static constexpr auto Elements( Self& self ) noexcept
+  {
+    CheckIndex<I>();
+    if constexpr( I == 0 )
+      return std::span( self.Data(), self.lo_ );
+    else
+      return std::span( self.Data() + ( Capacity - self.hi_ ), self.hi_ ) | std::views::reverse;
+  }
+
+  // Construct the live elements of an empty stack from those of rhs, in the same slots;
+  // Source is const T& to copy them or T&& to move them
+  template <typename Source, typename Rhs>
+  constexpr void ConstructFrom( Rhs& rhs )
+  {
+    for( ; lo_ < rhs.lo_; ++lo_ )
+      std::construct_at( Data() + lo_, static_cast<Source>( rhs.Data()[lo_] ) );
+    for( ; hi_ < rhs.hi_; ++hi_ )
+    {
+      const auto slot = Capacity - hi_ - 1u;
+      std::construct_at( Data() + slot, static_cast<Source>( rhs.Data()[slot] ) );
+    }
+  }
+
+  template <size_t I>
+  constexpr void CheckForEmptyStack( size_t elementsToRemove ) const
+  {
+    CheckElementsToRemove( elementsToRemove, Count<I>() );
+  }
+
+  constexpr void CheckForFullStack( size_t elementsToAdd ) const
+  {
+    CheckElementsToAdd<overflow::default_>( elementsToAdd, size(), capacity() );
+  }
+
+  constexpr T* Data() noexcept
+  {
+    return StorageData( c_ );
+  }
+
+  constexpr const T* Data() const noexcept
+  {
+    return StorageData( c_ );
+  }
+
+private:
+
+  // Stack 0 occupies c_[0, lo_) with its top at c_[lo_-1]; stack 1 occupies
+  // c_[Capacity-hi_, Capacity) with its top at c_[Capacity-hi_]
+
+  index_type lo_ = 0;
+  index_type hi_ = 0;
+  InlineStorage<T, Capacity> c_;
+
+}; // class twin_array_stack
+
+} // namespace PKIsensee
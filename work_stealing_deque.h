@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  work_stealing_deque.h
+//
+//  Copyright  Pete Isensee (PKIsensee@msn.com).
+//  All rights reserved worldwide.
+//
+//  Permission to copy, modify, reproduce or redistribute this source code is
+//  granted provided the above copyright notice is retained in the resulting
+//  source code.
+//
+//  This software is provided "as is" and without any express or implied
+//  warranties.
+//
+// -----------------------------------------------------------------------------
+//
+//  work_stealing_deque<T, Capacity> is a Chase-Lev work-stealing deque of maximum
+//  size Capacity, stored inline like array_stack.
+//
+//  A single owner thread pushes and pops at the top, using it as a LIFO stack.
+//  Any number of thief threads steal from the bottom, taking the oldest element.
+//  Because Capacity is fixed the ring buffer never grows, so the resize path of
+//  the classic algorithm doesn't exist. Memory orderings follow Le, Pop, Cohen and
+//  Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models".
+//
+//  Elements are read by thieves that may lose the race for them, so T must be
+//  trivially copyable, and small enough for std::atomic<T> to be lock-free;
+//  typically T is a task pointer or handle.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include "array_stack.h"
+
+namespace PKIsensee
+{
+
+template <typename T, size_t Capacity> // deque of objects T; maximum size Capacity
+class work_stealing_deque
+{
+  static_assert( std::is_trivially_copyable_v<T>, "T must be trivially copyable" );
+  static_assert( std::atomic<T>::is_always_lock_free,
+                 "work_stealing_deque requires lock-free atomics of T; use a smaller T, e.g. a pointer" );
+  static_assert( Capacity > 0 && ( Capacity & ( Capacity - 1 ) ) == 0,
+                 "Capacity must be a power of two" );
+
+public:
+
+  using value_type              = T;
+  using size_type               = size_t;
+
+  work_stealing_deque() = default;
+  work_stealing_deque( const work_stealing_deque& ) = delete;
+  work_stealing_deque& operator=( const work_stealing_deque& ) = delete;
+
+  // Snapshots; other threads may change the result before it is examined
+
+  bool empty() const noexcept
+  {
+    return size() == 0;
+  }
+
+  bool full() const noexcept
+  {
+    return size() == Capacity;
+  }
+
+  size_type size() const noexcept
+  {
+    const auto bottom = bottom_.load( std::memory_order_acquire );
+    const auto top = top_.load( std::memory_order_acquire );
+    return ( top > bottom ) ? static_cast<size_type>( top - bottom ) : 0;
+  }
+
+  static constexpr size_type capacity() noexcept
+  {
+    return Capacity;
+  }
+
+  // Owner thread only. Returns false if the deque is full.
+  bool try_push( const value_type& v ) noexcept
+  {
+    const auto top = top_.load( std::memory_order_relaxed );
+    const auto bottom = bottom_.load( std::memory_order_acquire );
+    if( top - bottom >= static_cast<int64_t>( Capacity ) )
+      return false;
+    Slot( top ).store( v, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    top_.store( top + 1, std::memory_order_relaxed );
+    return true;
+  }
+
+  // Owner thread only. Removes the newest element; returns false if the deque is empty.
+  bool try_pop( value_type& v ) noexcept
+  {
+    const auto top = top_.load( std::memory_order_relaxed ) - 1;
+    top_.store( top, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    auto bottom = bottom_.load( std::memory_order_relaxed );
+    if( bottom > top ) // empty
+    {
+      top_.store( top + 1, std::memory_order_relaxed );
+      return false;
+    }
+    v = Slot( top ).load( std::memory_order_relaxed );
+    if( bottom == top )
+    {
+      // Last element; race the thieves for it
+      const auto won = bottom_.compare_exchange_strong( bottom, bottom + 1,
+                                                        std::memory_order_seq_cst,
+                                                        std::memory_order_relaxed );
+      top_.store( top + 1, std::memory_order_relaxed );
+      return won;
+    }
+    return true;
+  }
+
+  // Any thread. Removes the oldest element; returns false if the deque is empty or
+  // another thread took the element first.
+  bool try_steal( value_type& v ) noexcept
+  {
+    auto bottom = bottom_.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    const auto top = top_.load( std::memory_order_acquire );
+    if( bottom >= top )
+      return false;
+    const auto stolen = Slot( bottom ).load( std::memory_order_relaxed );
+    if( !bottom_.compare_exchange_strong( bottom, bottom + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed ) )
+      return false;
+    v = stolen;
+    return true;
+  }
+
+private:
+
+  std::atomic<T>& Slot( int64_t i ) noexcept
+  {
+    return ring_[static_cast<size_t>( i ) & ( Capacity - 1 )];
+  }
+
+private:
+
+  // top_ is where the owner pushes next and moves both ways; bottom_ is the oldest
+  // element and only increases. Live elements are ring_[bottom_, top_) modulo Capacity.
+
+  alignas( CacheLine ) std::atomic<int64_t> top_ = 0;
+  alignas( CacheLine ) std::atomic<int64_t> bottom_ = 0;
+  alignas( CacheLine ) std::array<std::atomic<T>, Capacity> ring_ {};
+
+}; // class work_stealing_deque
+
+} // namespace PKIsensee